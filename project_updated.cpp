@@ -2,12 +2,37 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <chrono> // For time-series analysis
 #include <ctime>  // For time-series analysis
+#include <thread>     // For background persistence
+#include <atomic>
+#include <mutex>      // For the background persistence queue
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <charconv>   // For allocation-free number parsing
+#include <string_view>
+#include <iterator>
+#include <bitset>
+#include <cmath>
+#ifndef _WIN32
+#include <fcntl.h>    // For memory-mapped snapshot loading and fsync
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>    // For _commit
+#include <io.h>
+#include <sys/stat.h>
+#endif
 
 using namespace std;
 
@@ -17,606 +42,4236 @@ bool is_button_clicked(float x, float y, float width, float height);
 string get_text_input(const string& prompt, float x, float y, float width, float height);
 
 // --- Structs ---
+
+/**
+ * Amount of money held as a whole number of cents, so totals are exact and can be
+ * summed in any order
+ */
+struct Money {
+    int64_t cents = 0;
+
+    Money& operator+=(Money other) { cents += other.cents; return *this; }
+    Money& operator-=(Money other) { cents -= other.cents; return *this; }
+    friend Money operator+(Money a, Money b) { return a += b; }
+    friend Money operator-(Money a, Money b) { return a -= b; }
+    friend bool operator==(Money a, Money b) { return a.cents == b.cents; }
+    friend bool operator!=(Money a, Money b) { return a.cents != b.cents; }
+    friend bool operator<(Money a, Money b) { return a.cents < b.cents; }
+    friend bool operator>(Money a, Money b) { return a.cents > b.cents; }
+    friend bool operator<=(Money a, Money b) { return a.cents <= b.cents; }
+    friend bool operator>=(Money a, Money b) { return a.cents >= b.cents; }
+};
+
+using CategoryId = uint32_t;
+
+/**
+ * Category names interned to dense ids. Ids are never reused, so transactions hold an
+ * id and per-category totals live in an array indexed by it.
+ */
+struct CategoryDictionary {
+    vector<string> names;
+    unordered_map<string, CategoryId> ids;
+
+    CategoryId intern(string_view name) {
+        auto [it, inserted] = ids.try_emplace(string(name), static_cast<CategoryId>(names.size()));
+        if (inserted) names.push_back(it->first);
+        return it->second;
+    }
+
+    bool find(const string& name, CategoryId& id) const {
+        auto it = ids.find(name);
+        if (it == ids.end()) return false;
+        id = it->second;
+        return true;
+    }
+
+    const string& name(CategoryId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+};
+
+/**
+ * Calendar date packed as days since 1970-01-01. Parsed once when a transaction is
+ * entered or loaded; turned back into YYYY-MM-DD only for display and text files.
+ */
+struct Date {
+    static constexpr int32_t MIN_DAYS = -719528;  // 0000-01-01
+    static constexpr int32_t MAX_DAYS = 2932896;  // 9999-12-31
+    static constexpr int32_t NONE = INT32_MIN;    // Missing or unreadable date in old data
+
+    int32_t days = NONE;
+
+    bool valid() const { return days != NONE; }
+    friend bool operator==(Date a, Date b) { return a.days == b.days; }
+    friend bool operator!=(Date a, Date b) { return a.days != b.days; }
+    friend bool operator<(Date a, Date b) { return a.days < b.days; }
+};
+
 struct Transaction {
-    string date;
-    string category;
+    Date date;
+    CategoryId category; // Index into the owning user's CategoryDictionary
     string description;
-    float amount;
+    Money amount;
     char type; // 'I' (income) or 'E' (expense)
     int id;    // Unique ID for easy editing/deleting
 };
 
-struct UserProfile {
-    string username;
-    string password; // Added for security
-    vector<Transaction> transactions;
-    map<string, float> budgetPerCategory;
-    int next_transaction_id = 1; // To ensure unique transaction IDs
+/**
+ * Income and expense totals for one calendar month or year
+ */
+struct PeriodTotals {
+    Money income;
+    Money expense;
+    size_t count = 0; // Live transactions in the period
 };
 
-// --- Global Variables (for UI context) ---
-UserProfile* g_current_user = nullptr; // Pointer to the currently logged-in user
-vector<UserProfile> g_users;           // All loaded users
+/**
+ * PeriodTotals for consecutive months, stored densely from the earliest month ever given
+ * a transaction to the latest. Updates are an index computation, and a report walks the
+ * span in order without sorting. Months emptied by deletes keep a zero count and are
+ * skipped by readers.
+ */
+class PeriodRollup {
+public:
+    int64_t first() const { return first_; }
+    int64_t end() const { return first_ + static_cast<int64_t>(periods_.size()); }
+    const PeriodTotals& operator[](int64_t key) const { return periods_[key - first_]; }
 
-// --- Utility Functions ---
+    void add(int64_t key, char type, Money amount) {
+        if (key < first_ || key >= end()) grow(key);
+        PeriodTotals& totals = periods_[key - first_];
+        if (type == 'I') totals.income += amount;
+        else totals.expense += amount;
+        totals.count++;
+    }
+
+    /** Undo add(); the period must hold this transaction */
+    void subtract(int64_t key, char type, Money amount) {
+        PeriodTotals& totals = periods_[key - first_];
+        if (type == 'I') totals.income -= amount;
+        else totals.expense -= amount;
+        totals.count--;
+    }
+
+private:
+    void grow(int64_t key) {
+        if (periods_.empty()) {
+            first_ = key;
+        } else if (key < first_) {
+            periods_.insert(periods_.begin(), static_cast<size_t>(first_ - key), PeriodTotals());
+            first_ = key;
+        }
+        if (key >= end()) periods_.resize(static_cast<size_t>(key - first_ + 1));
+    }
+
+    vector<PeriodTotals> periods_;
+    int64_t first_ = 0;
+};
+
+// Forward declarations for date arithmetic (defined under Utility Functions)
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d);
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d);
+
+class TransactionStore;
 
 /**
- * Draw text centered horizontally on the screen at specified vertical position
+ * Read-only view of one row of a TransactionStore
  */
-void draw_text_centered(const string &text, int y, color clr = COLOR_BLACK) {
-    if (!has_font("default_font"))
-        load_font("default_font", "arial.ttf");
-    font fnt = font_named("default_font");
-    int w = text_width(text, "default_font", 20);
-    int x = (screen_width() - w) / 2;
-    draw_text(text, clr, "default_font", 20, x, y);
-}
+class TransactionRef {
+public:
+    TransactionRef(const TransactionStore* store, size_t row) : store_(store), row_(row) {}
+
+    size_t row() const { return row_; }
+    int id() const;
+    Date date() const;
+    CategoryId category() const;
+    Money amount() const;
+    char type() const;
+    string_view description() const;
+    Transaction value() const;
+
+private:
+    const TransactionStore* store_;
+    size_t row_;
+};
 
 /**
- * Format float amount as a string with two decimal places
+ * Hash map from transaction id to row. Open addressing with linear probing keeps it to
+ * one flat array; deletion shifts later entries back, so no tombstones build up.
  */
-string format_amount(float amount) {
-    ostringstream oss;
-    oss << fixed << setprecision(2) << amount;
-    return oss.str();
-}
+class IdIndex {
+public:
+    bool find(int id, size_t& row) const {
+        if (slots_.empty()) return false;
+        for (size_t i = home(id); slots_[i].row != EMPTY; i = (i + 1) & mask()) {
+            if (slots_[i].id == id) {
+                row = slots_[i].row;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Map `id` to `row`, replacing any existing entry for `id`
+     */
+    void insert(int id, size_t row) {
+        if ((count_ + 1) * 2 > slots_.size()) grow();
+        size_t i = home(id);
+        while (slots_[i].row != EMPTY && slots_[i].id != id) i = (i + 1) & mask();
+        if (slots_[i].row == EMPTY) count_++;
+        slots_[i] = {id, static_cast<uint32_t>(row)};
+    }
+
+    void erase(int id) {
+        if (slots_.empty()) return;
+        size_t i = home(id);
+        while (slots_[i].row != EMPTY && slots_[i].id != id) i = (i + 1) & mask();
+        if (slots_[i].row == EMPTY) return;
+        slots_[i].row = EMPTY;
+        count_--;
+        // Pull back any later entry whose probe sequence passed through the freed slot
+        for (size_t j = (i + 1) & mask(); slots_[j].row != EMPTY; j = (j + 1) & mask()) {
+            size_t k = home(slots_[j].id);
+            bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+            if (stays) continue;
+            slots_[i] = slots_[j];
+            slots_[j].row = EMPTY;
+            i = j;
+        }
+    }
+
+    void reserve(size_t n) {
+        while (n * 2 > slots_.size()) grow();
+    }
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot {
+        int id;
+        uint32_t row;
+    };
+
+    size_t mask() const { return slots_.size() - 1; }
+
+    size_t home(int id) const {
+        return (static_cast<uint32_t>(id) * 2654435769u) >> (32 - bits_); // Fibonacci hashing
+    }
+
+    void grow() {
+        vector<Slot> old = move(slots_);
+        bits_ = old.empty() ? 4 : bits_ + 1;
+        slots_.assign(size_t(1) << bits_, Slot{0, EMPTY});
+        count_ = 0;
+        for (const auto& slot : old) {
+            if (slot.row != EMPTY) insert(slot.id, slot.row);
+        }
+    }
+
+    vector<Slot> slots_;
+    size_t count_ = 0;
+    unsigned bits_ = 0;
+};
 
 /**
- * Draw a menu item at given coordinates with specified color
+ * Rows ordered by date, for range scans. A large sorted run takes appends in date order
+ * directly; anything else goes to a small sorted delta that is merged into the run once it
+ * passes the square root of the run's size. Erased entries are tombstoned in place and
+ * dropped by the next merge. Rows of the same day are kept in row (insertion) order.
+ * Undated rows are not indexed.
  */
-void draw_menu_item(const string &text, int x, int y, color clr = COLOR_BLACK) {
-    draw_text(text, clr, x, y);
+class DateIndex {
+public:
+    bool built() const { return built_; }
+
+    /**
+     * Index every live dated row. Until this is called, insert and erase do nothing.
+     */
+    void build(const vector<Date>& dates, const vector<uint8_t>& live) {
+        run_.clear();
+        delta_.clear();
+        tombstones_ = 0;
+        for (size_t row = 0; row < dates.size(); row++) {
+            if (live[row] && dates[row].valid()) run_.push_back({dates[row].days, static_cast<uint32_t>(row)});
+        }
+        stable_sort(run_.begin(), run_.end(), [](const Entry& a, const Entry& b) { return a.days < b.days; });
+        built_ = true;
+    }
+
+    /** Forget every entry; the next build() starts over */
+    void clear() {
+        run_.clear();
+        delta_.clear();
+        tombstones_ = 0;
+        built_ = false;
+    }
+
+    void insert(Date date, size_t row) {
+        if (!built_ || !date.valid()) return;
+        Entry entry{date.days, static_cast<uint32_t>(row)};
+        if (delta_.empty() && (run_.empty() || !(entry < run_.back()))) {
+            run_.push_back(entry); // In date order: no need to go through the delta
+            return;
+        }
+        delta_.insert(upper_bound(delta_.begin(), delta_.end(), entry), entry);
+        if (delta_.size() >= MIN_DELTA_TO_MERGE && delta_.size() * delta_.size() >= run_.size()) merge();
+    }
+
+    void erase(Date date, size_t row) {
+        if (!built_ || !date.valid()) return;
+        Entry entry{date.days, static_cast<uint32_t>(row)};
+        for (vector<Entry>* entries : {&run_, &delta_}) {
+            // Equal keys are this row's own tombstones from earlier edits, so this loop is short
+            for (auto it = lower_bound(entries->begin(), entries->end(), entry); it != entries->end() && !(entry < *it); ++it) {
+                if (it->row != entry.row) continue;
+                it->row |= TOMBSTONE; // Keeps its place in the order, so binary searches stay valid
+                tombstones_++;
+                if (tombstones_ >= MIN_DELTA_TO_MERGE && tombstones_ * 4 >= run_.size()) merge();
+                return;
+            }
+        }
+    }
+
+    /**
+     * Apply a compaction of the store: new_rows[old row] is the row's new number. Dead rows
+     * have no entries by then, and the rest keep their relative order, so the run stays sorted.
+     */
+    void renumber(const vector<uint32_t>& new_rows) {
+        if (!built_) return;
+        merge();
+        for (Entry& entry : run_) entry.row = new_rows[entry.row];
+    }
+
+    /**
+     * Call visit(row) for each entry dated from `from` to `to`, in date order, until it returns false
+     */
+    template <typename Visit>
+    void scan(Date from, Date to, Visit visit) const {
+        Entry first{from.days, 0};
+        auto run = lower_bound(run_.begin(), run_.end(), first);
+        auto delta = lower_bound(delta_.begin(), delta_.end(), first);
+        while (true) {
+            bool run_left = run != run_.end() && run->days <= to.days;
+            bool delta_left = delta != delta_.end() && delta->days <= to.days;
+            if (!run_left && !delta_left) return;
+            const Entry& next = !delta_left || (run_left && *run < *delta) ? *run++ : *delta++;
+            if (!(next.row & TOMBSTONE) && !visit(static_cast<size_t>(next.row))) return;
+        }
+    }
+
+private:
+    static constexpr size_t MIN_DELTA_TO_MERGE = 256;
+    static constexpr uint32_t TOMBSTONE = 0x80000000u; // Flag bit on an erased entry's row
+
+    struct Entry {
+        int32_t days;
+        uint32_t row;
+
+        // By date, then row; a tombstone sorts where its entry did
+        bool operator<(const Entry& other) const {
+            if (days != other.days) return days < other.days;
+            return (row & ~TOMBSTONE) < (other.row & ~TOMBSTONE);
+        }
+    };
+
+    void merge() {
+        vector<Entry> merged;
+        merged.reserve(run_.size() + delta_.size() - tombstones_);
+        auto run = run_.begin(), delta = delta_.begin();
+        while (run != run_.end() || delta != delta_.end()) {
+            const Entry& next = delta == delta_.end() || (run != run_.end() && *run < *delta) ? *run++ : *delta++;
+            if (!(next.row & TOMBSTONE)) merged.push_back(next);
+        }
+        run_ = move(merged);
+        delta_.clear();
+        tombstones_ = 0;
+    }
+
+    vector<Entry> run_;
+    vector<Entry> delta_;
+    size_t tombstones_ = 0;
+    bool built_ = false;
+};
+
+/**
+ * Net flow (income minus expenses) per day in a Fenwick tree, so the balance as of any
+ * date and the net flow between two dates are O(log days) sums, and a mutation is an
+ * O(log days) update. Covers only the span of days the user has transactions on, growing
+ * by doubling when a date falls outside it.
+ */
+class BalanceTree {
+public:
+    bool built() const { return built_; }
+
+    /**
+     * Sum every live dated row. Until this is called, add does nothing.
+     */
+    void build(const vector<Date>& dates, const vector<Money>& amounts, const vector<char>& types, const vector<uint8_t>& live) {
+        clear();
+        built_ = true;
+        int32_t first = Date::MAX_DAYS, last = Date::MIN_DAYS;
+        for (size_t row = 0; row < dates.size(); row++) {
+            if (!live[row] || !dates[row].valid()) continue;
+            first = min(first, dates[row].days);
+            last = max(last, dates[row].days);
+        }
+        if (first > last) return;
+        first_ = first;
+        tree_.assign(static_cast<size_t>(last - first) + 2, 0);
+        for (size_t row = 0; row < dates.size(); row++) { // Day sums first, then one O(days) pass
+            if (live[row] && dates[row].valid()) tree_[dates[row].days - first_ + 1] += netCents(types[row], amounts[row]);
+        }
+        toTree();
+    }
+
+    void clear() {
+        tree_.clear();
+        first_ = 0;
+        built_ = false;
+    }
+
+    /** Count a row (adding) or stop counting it */
+    void add(Date date, char type, Money amount, bool adding) {
+        if (!built_ || !date.valid()) return;
+        int64_t cents = netCents(type, amount);
+        if (cents == 0) return;
+        cover(date.days);
+        for (size_t i = static_cast<size_t>(date.days - first_) + 1; i < tree_.size(); i += i & (~i + 1)) {
+            tree_[i] += adding ? cents : -cents;
+        }
+    }
+
+    /** Net flow of every day up to and including `days` */
+    Money through(int32_t days) const {
+        if (tree_.empty() || days < first_) return Money();
+        size_t i = static_cast<size_t>(min<int64_t>(int64_t(days) - first_ + 1, static_cast<int64_t>(tree_.size()) - 1));
+        int64_t cents = 0;
+        for (; i > 0; i -= i & (~i + 1)) cents += tree_[i];
+        return Money{cents};
+    }
+
+private:
+    static int64_t netCents(char type, Money amount) {
+        return type == 'I' ? amount.cents : type == 'E' ? -amount.cents : 0;
+    }
+
+    /**
+     * Make sure `days` has a bucket, doubling the covered span towards it if needed
+     */
+    void cover(int32_t days) {
+        size_t size = tree_.empty() ? 0 : tree_.size() - 1;
+        if (size > 0 && days >= first_ && days - first_ < static_cast<int64_t>(size)) return;
+
+        int64_t first = size == 0 ? days : min<int64_t>(first_, days);
+        int64_t end = size == 0 ? int64_t(days) + 1 : max<int64_t>(first_ + static_cast<int64_t>(size), int64_t(days) + 1);
+        int64_t new_size = max<int64_t>({end - first, static_cast<int64_t>(size) * 2, 64});
+        if (size > 0 && days < first_) first = end - new_size; // Leave room in the direction of growth
+        else end = first + new_size;
+        first = max<int64_t>(first, Date::MIN_DAYS);
+        end = min<int64_t>(end, int64_t(Date::MAX_DAYS) + 1);
+
+        toDaySums();
+        vector<int64_t> grown(static_cast<size_t>(end - first) + 1, 0);
+        for (size_t i = 1; i <= size; i++) grown[static_cast<size_t>(first_ - first) + i] = tree_[i];
+        tree_ = move(grown);
+        first_ = static_cast<int32_t>(first);
+        toTree();
+    }
+
+    // Turn per-day sums into Fenwick nodes in O(days), and back
+    void toTree() {
+        for (size_t i = 1; i < tree_.size(); i++) {
+            size_t parent = i + (i & (~i + 1));
+            if (parent < tree_.size()) tree_[parent] += tree_[i];
+        }
+    }
+
+    void toDaySums() {
+        for (size_t i = tree_.empty() ? 0 : tree_.size() - 1; i > 0; i--) {
+            size_t parent = i + (i & (~i + 1));
+            if (parent < tree_.size()) tree_[parent] -= tree_[i];
+        }
+    }
+
+    vector<int64_t> tree_; // 1-based; node i covers the lowest-set-bit-of-i days ending at first_ + i - 1
+    int32_t first_ = 0;    // Day of bucket 1
+    bool built_ = false;
+};
+
+/**
+ * Inverted index over descriptions. Every lowercased word is split into grams: its first
+ * byte and first two bytes, so short search terms can match the start of a word, and each
+ * three-byte run (trigram), so longer terms can match anywhere. Each gram maps to a sorted
+ * list of rows. Edits and deletes only add entries: candidates are always checked against
+ * the text, so stale rows fall out, and the owner rebuilds the index once stale entries
+ * outnumber the rest.
+ */
+class SearchIndex {
+public:
+    static constexpr size_t MIN_TRIGRAM_TERM = 3; // Shorter terms match the start of a word
+
+    bool built() const { return built_; }
+
+    /** Start an empty index; rows are then given to add() */
+    void start() {
+        clear();
+        built_ = true;
+    }
+
+    void clear() {
+        grams_.clear();
+        postings_ = 0;
+        stale_ = 0;
+        built_ = false;
+    }
+
+    void add(size_t row, string_view text) {
+        if (!built_) return;
+        uint32_t r = static_cast<uint32_t>(row);
+        forEachWord(text, [&](const string& word) {
+            forEachGram(word, [&](uint32_t gram) { postings_ += addPosting(grams_[gram], r); });
+        });
+    }
+
+    /** Note that a row no longer has this text; its entries stay until the next rebuild */
+    void retire(string_view text) {
+        if (!built_) return;
+        forEachWord(text, [&](const string& word) { forEachGram(word, [&](uint32_t) { stale_++; }); });
+    }
+
+    bool mostly_stale() const { return built_ && stale_ >= 4096 && stale_ * 2 > postings_; }
+
+    /**
+     * Apply a compaction of the store: new_rows[old row] is the new number, or UINT32_MAX for
+     * a dropped row. Rows keep their relative order, so the lists stay sorted.
+     */
+    void renumber(const vector<uint32_t>& new_rows) {
+        if (!built_) return;
+        size_t dropped = 0;
+        for (auto it = grams_.begin(); it != grams_.end(); ) {
+            vector<uint32_t>& rows = it->second;
+            size_t out = 0;
+            for (uint32_t row : rows) {
+                if (new_rows[row] != UINT32_MAX) rows[out++] = new_rows[row];
+            }
+            dropped += rows.size() - out;
+            rows.resize(out);
+            it = out == 0 ? grams_.erase(it) : next(it);
+        }
+        postings_ -= dropped;
+        stale_ -= min(stale_, dropped);
+    }
+
+    /**
+     * Sorted rows that may contain a lowercased term; every row that does is included.
+     * Uses the term's rarest gram, so the list is as short as the index can make it.
+     */
+    const vector<uint32_t>& candidates(const string& term) const {
+        static const vector<uint32_t> none;
+        const vector<uint32_t>* rarest = nullptr;
+        auto consider = [&](uint32_t gram) {
+            auto it = grams_.find(gram);
+            const vector<uint32_t>* rows = it == grams_.end() ? &none : &it->second;
+            if (!rarest || rows->size() < rarest->size()) rarest = rows;
+        };
+        if (term.size() < MIN_TRIGRAM_TERM) {
+            consider(prefixGram(term, term.size()));
+        } else {
+            for (size_t i = 0; i + 3 <= term.size(); i++) consider(trigram(term, i));
+        }
+        return rarest ? *rarest : none;
+    }
+
+    static bool isWordByte(char c) {
+        return isalnum(static_cast<unsigned char>(c)) || static_cast<unsigned char>(c) >= 0x80; // Keep UTF-8 letters whole
+    }
+
+    static char lowerByte(char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+
+    /** Call f(word) with each lowercased word of text */
+    template <typename F>
+    static void forEachWord(string_view text, F f) {
+        string word;
+        for (size_t i = 0; i <= text.size(); i++) {
+            if (i < text.size() && isWordByte(text[i])) {
+                word += lowerByte(text[i]);
+            } else if (!word.empty()) {
+                f(word);
+                word.clear();
+            }
+        }
+    }
+
+    /**
+     * Whether text contains a lowercased term, ignoring case. Short terms must start a word,
+     * matching what the prefix grams can find.
+     */
+    static bool matches(string_view text, const string& term) {
+        for (size_t i = 0; i + term.size() <= text.size(); i++) {
+            if (term.size() < MIN_TRIGRAM_TERM && i > 0 && isWordByte(text[i - 1])) continue;
+            size_t k = 0;
+            while (k < term.size() && lowerByte(text[i + k]) == term[k]) k++;
+            if (k == term.size()) return true;
+        }
+        return false;
+    }
+
+private:
+    // Trigrams use the low 24 bits; prefixes are tagged above them so the keys never collide
+    static uint32_t trigram(const string& word, size_t i) {
+        return uint32_t(uint8_t(word[i])) << 16 | uint32_t(uint8_t(word[i + 1])) << 8 | uint8_t(word[i + 2]);
+    }
+
+    static uint32_t prefixGram(const string& word, size_t length) {
+        return length == 1 ? (1u << 24 | uint8_t(word[0])) : (2u << 24 | uint32_t(uint8_t(word[0])) << 8 | uint8_t(word[1]));
+    }
+
+    template <typename F>
+    static void forEachGram(const string& word, F f) {
+        f(prefixGram(word, 1));
+        if (word.size() >= 2) f(prefixGram(word, 2));
+        for (size_t i = 0; i + 3 <= word.size(); i++) f(trigram(word, i));
+    }
+
+    /** Returns 1 if the row was added, 0 if it was already listed */
+    static size_t addPosting(vector<uint32_t>& rows, uint32_t row) {
+        if (rows.empty() || rows.back() < row) {
+            rows.push_back(row);
+            return 1;
+        }
+        auto it = lower_bound(rows.begin(), rows.end(), row); // An edited row, re-added out of order
+        if (it != rows.end() && *it == row) return 0;
+        rows.insert(it, row);
+        return 1;
+    }
+
+    unordered_map<uint32_t, vector<uint32_t>> grams_;
+    size_t postings_ = 0;
+    size_t stale_ = 0;      // Entries for text that has since been edited or deleted
+    bool built_ = false;
+};
+
+/**
+ * Compressed set of row numbers in the style of a roaring bitmap. Rows are split into
+ * chunks of 65536 by their high 16 bits; a chunk stores its low 16 bits as a sorted array
+ * while it has at most 4096 members and as a 65536-bit bitmap once it has more. Sparse sets
+ * stay small, dense ones cost one bit per row, and AND/OR work a chunk at a time.
+ */
+class RowBitmap {
+public:
+    bool empty() const { return chunks_.empty(); }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const Chunk& chunk : chunks_) total += chunk.count;
+        return total;
+    }
+
+    bool contains(size_t row) const {
+        const Chunk* chunk = findChunk(static_cast<uint16_t>(row >> 16));
+        return chunk && chunk->contains(static_cast<uint16_t>(row));
+    }
+
+    void insert(size_t row) {
+        uint16_t key = static_cast<uint16_t>(row >> 16);
+        if (chunks_.empty() || chunks_.back().key < key) {
+            chunks_.push_back(Chunk{key}); // Rows are mostly added in increasing order
+        } else if (chunks_.back().key != key) {
+            auto it = lower_bound(chunks_.begin(), chunks_.end(), key, [](const Chunk& c, uint16_t k) { return c.key < k; });
+            if (it == chunks_.end() || it->key != key) it = chunks_.insert(it, Chunk{key});
+            it->insert(static_cast<uint16_t>(row));
+            return;
+        }
+        chunks_.back().insert(static_cast<uint16_t>(row));
+    }
+
+    void erase(size_t row) {
+        uint16_t key = static_cast<uint16_t>(row >> 16);
+        auto it = lower_bound(chunks_.begin(), chunks_.end(), key, [](const Chunk& c, uint16_t k) { return c.key < k; });
+        if (it == chunks_.end() || it->key != key) return;
+        it->erase(static_cast<uint16_t>(row));
+        if (it->count == 0) chunks_.erase(it);
+    }
+
+    RowBitmap& operator&=(const RowBitmap& other) {
+        vector<Chunk> result;
+        auto a = chunks_.begin();
+        auto b = other.chunks_.begin();
+        while (a != chunks_.end() && b != other.chunks_.end()) {
+            if (a->key < b->key) {
+                ++a;
+            } else if (b->key < a->key) {
+                ++b;
+            } else {
+                Chunk both = intersect(*a, *b);
+                if (both.count > 0) result.push_back(move(both));
+                ++a;
+                ++b;
+            }
+        }
+        chunks_ = move(result);
+        return *this;
+    }
+
+    RowBitmap& operator|=(const RowBitmap& other) {
+        vector<Chunk> result;
+        result.reserve(chunks_.size() + other.chunks_.size());
+        auto a = chunks_.begin();
+        auto b = other.chunks_.begin();
+        while (a != chunks_.end() || b != other.chunks_.end()) {
+            if (b == other.chunks_.end() || (a != chunks_.end() && a->key < b->key)) {
+                result.push_back(move(*a++));
+            } else if (a == chunks_.end() || b->key < a->key) {
+                result.push_back(*b++);
+            } else {
+                result.push_back(unite(*a++, *b++));
+            }
+        }
+        chunks_ = move(result);
+        return *this;
+    }
+
+    /**
+     * The rows whose bits are set in `words`, where bit i of words[w] stands for row w * 64 + i
+     */
+    static RowBitmap fromWords(const vector<uint64_t>& words) {
+        RowBitmap result;
+        for (size_t first = 0; first < words.size(); first += WORDS) {
+            size_t end = min(words.size(), first + WORDS);
+            Chunk chunk{static_cast<uint16_t>(first / WORDS)};
+            for (size_t w = first; w < end; w++) chunk.count += bitCount(words[w]);
+            if (chunk.count == 0) continue;
+            chunk.bits.assign(words.begin() + first, words.begin() + end);
+            chunk.bits.resize(WORDS);
+            if (chunk.count <= MAX_ARRAY) chunk.toArray();
+            result.chunks_.push_back(move(chunk));
+        }
+        return result;
+    }
+
+    friend RowBitmap operator&(RowBitmap a, const RowBitmap& b) { return a &= b; }
+    friend RowBitmap operator|(RowBitmap a, const RowBitmap& b) { return a |= b; }
+
+    /**
+     * Call visit(row) for each member in increasing order until it returns false
+     */
+    template <typename Visit>
+    void for_each(Visit visit) const {
+        for (const Chunk& chunk : chunks_) {
+            size_t high = size_t(chunk.key) << 16;
+            if (!chunk.dense()) {
+                for (uint16_t low : chunk.array) {
+                    if (!visit(high | low)) return;
+                }
+                continue;
+            }
+            for (size_t w = 0; w < WORDS; w++) {
+                for (uint64_t bits = chunk.bits[w]; bits != 0; bits &= bits - 1) {
+                    if (!visit(high | (w * 64 + lowestBit(bits)))) return;
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t WORDS = 65536 / 64;
+    static constexpr size_t MAX_ARRAY = 4096;       // Past this an array takes more room than a bitmap
+    static constexpr size_t MIN_BITMAP = 2048;      // Below this a bitmap goes back to an array; the gap stops flapping
+
+    struct Chunk {
+        uint16_t key;
+        uint32_t count = 0;
+        vector<uint16_t> array; // Sorted; used while bits is empty
+        vector<uint64_t> bits;  // WORDS words once dense
+
+        explicit Chunk(uint16_t chunk_key) : key(chunk_key) {}
+
+        bool dense() const { return !bits.empty(); }
+
+        bool contains(uint16_t low) const {
+            if (dense()) return bits[low >> 6] >> (low & 63) & 1;
+            return binary_search(array.begin(), array.end(), low);
+        }
+
+        void insert(uint16_t low) {
+            if (dense()) {
+                uint64_t mask = uint64_t(1) << (low & 63);
+                count += (bits[low >> 6] & mask) == 0;
+                bits[low >> 6] |= mask;
+                return;
+            }
+            if (array.empty() || array.back() < low) {
+                array.push_back(low);
+            } else {
+                auto it = lower_bound(array.begin(), array.end(), low);
+                if (*it == low) return;
+                array.insert(it, low);
+            }
+            count++;
+            if (count > MAX_ARRAY) toBits();
+        }
+
+        void erase(uint16_t low) {
+            if (dense()) {
+                uint64_t mask = uint64_t(1) << (low & 63);
+                if ((bits[low >> 6] & mask) == 0) return;
+                bits[low >> 6] &= ~mask;
+                if (--count < MIN_BITMAP) toArray();
+                return;
+            }
+            auto it = lower_bound(array.begin(), array.end(), low);
+            if (it == array.end() || *it != low) return;
+            array.erase(it);
+            count--;
+        }
+
+        void toBits() {
+            bits.assign(WORDS, 0);
+            for (uint16_t low : array) bits[low >> 6] |= uint64_t(1) << (low & 63);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void toArray() {
+            array.clear();
+            array.reserve(count);
+            for (size_t w = 0; w < WORDS; w++) {
+                for (uint64_t word = bits[w]; word != 0; word &= word - 1) array.push_back(static_cast<uint16_t>(w * 64 + lowestBit(word)));
+            }
+            bits.clear();
+            bits.shrink_to_fit();
+        }
+    };
+
+    static unsigned lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+        unsigned n = 0;
+        while ((word & 1) == 0) { word >>= 1; n++; }
+        return n;
+#endif
+    }
+
+    static unsigned bitCount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_popcountll(word));
+#else
+        return static_cast<unsigned>(bitset<64>(word).count());
+#endif
+    }
+
+    static Chunk intersect(const Chunk& a, const Chunk& b) {
+        Chunk out{a.key};
+        if (a.dense() && b.dense()) {
+            out.bits.resize(WORDS);
+            for (size_t w = 0; w < WORDS; w++) {
+                out.bits[w] = a.bits[w] & b.bits[w];
+                out.count += bitCount(out.bits[w]);
+            }
+            if (out.count <= MAX_ARRAY) out.toArray();
+            return out;
+        }
+        if (a.dense() || b.dense()) {
+            const Chunk& sparse = a.dense() ? b : a;
+            const Chunk& dense = a.dense() ? a : b;
+            for (uint16_t low : sparse.array) {
+                if (dense.contains(low)) out.array.push_back(low);
+            }
+        } else {
+            set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+        }
+        out.count = static_cast<uint32_t>(out.array.size());
+        return out;
+    }
+
+    static Chunk unite(Chunk a, const Chunk& b) {
+        if (!a.dense() && !b.dense() && a.count + b.count <= MAX_ARRAY) {
+            Chunk out{a.key};
+            set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), back_inserter(out.array));
+            out.count = static_cast<uint32_t>(out.array.size());
+            return out;
+        }
+        if (!a.dense()) a.toBits();
+        if (b.dense()) {
+            for (size_t w = 0; w < WORDS; w++) a.bits[w] |= b.bits[w];
+        } else {
+            for (uint16_t low : b.array) a.bits[low >> 6] |= uint64_t(1) << (low & 63);
+        }
+        a.count = 0;
+        for (uint64_t word : a.bits) a.count += bitCount(word);
+        return a;
+    }
+
+    const Chunk* findChunk(uint16_t key) const {
+        auto it = lower_bound(chunks_.begin(), chunks_.end(), key, [](const Chunk& c, uint16_t k) { return c.key < k; });
+        return it == chunks_.end() || it->key != key ? nullptr : &*it;
+    }
+
+    vector<Chunk> chunks_; // Sorted by key
+};
+
+/**
+ * A RowBitmap of live rows per category and per type, so filters combine with AND/OR
+ * instead of testing every row. Rebuilt from the columns after a compaction renumbers rows.
+ */
+class BitmapIndex {
+public:
+    bool built() const { return built_; }
+
+    void build(const vector<CategoryId>& categories, const vector<char>& types, const vector<uint8_t>& live) {
+        clear();
+        built_ = true;
+        for (size_t row = 0; row < live.size(); row++) {
+            if (live[row]) add(row, categories[row], types[row]);
+        }
+    }
+
+    void clear() {
+        by_category_.clear();
+        income_ = RowBitmap();
+        expense_ = RowBitmap();
+        built_ = false;
+    }
+
+    void add(size_t row, CategoryId category, char type) {
+        if (!built_) return;
+        if (category >= by_category_.size()) by_category_.resize(category + 1);
+        by_category_[category].insert(row);
+        if (type == 'I') income_.insert(row);
+        if (type == 'E') expense_.insert(row);
+    }
+
+    void remove(size_t row, CategoryId category, char type) {
+        if (!built_) return;
+        if (category < by_category_.size()) by_category_[category].erase(row);
+        if (type == 'I') income_.erase(row);
+        if (type == 'E') expense_.erase(row);
+    }
+
+    const RowBitmap& category(CategoryId category) const {
+        static const RowBitmap none;
+        return category < by_category_.size() ? by_category_[category] : none;
+    }
+
+    const RowBitmap& type(char type) const {
+        static const RowBitmap none;
+        return type == 'I' ? income_ : type == 'E' ? expense_ : none;
+    }
+
+private:
+    vector<RowBitmap> by_category_;
+    RowBitmap income_;
+    RowBitmap expense_;
+    bool built_ = false;
+};
+
+/**
+ * A secondary index that the store builds on first use. Copying one yields an empty,
+ * unbuilt index rather than a copy: snapshots copy a user's store on the UI thread and
+ * never query it, and a copy that is queried rebuilds what it needs. Moves keep the index.
+ */
+template <typename Index>
+class LazyIndex : public Index {
+public:
+    LazyIndex() = default;
+    LazyIndex(const LazyIndex&) : Index() {}
+    LazyIndex(LazyIndex&&) = default;
+    LazyIndex& operator=(const LazyIndex&) {
+        static_cast<Index&>(*this) = Index();
+        return *this;
+    }
+    LazyIndex& operator=(LazyIndex&&) = default;
+};
+
+/**
+ * A user's transactions stored column by column. Scans over amounts, types, dates and
+ * categories touch only those arrays; descriptions live in one side heap and are only
+ * read for display and saving. Rows keep their insertion order, and ids are unique:
+ * an IdIndex finds the row for an id in constant time.
+ *
+ * Deleting only marks a row dead (live() is 0, amount 0, type '\0'), so it is O(1) and
+ * leaves every other row number alone. Scans that filter on type skip dead rows without
+ * checking live(); iteration and size() skip them too. compact() squeezes dead rows out
+ * and runs by itself once they make up a quarter of the store.
+ */
+class TransactionStore {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = TransactionRef;
+        using difference_type = ptrdiff_t;
+        using pointer = void;
+        using reference = TransactionRef;
+
+        const_iterator(const TransactionStore* store, size_t row) : store_(store), row_(row) { skipDead(); }
+        TransactionRef operator*() const { return TransactionRef(store_, row_); }
+        const_iterator& operator++() { row_++; skipDead(); return *this; }
+        bool operator==(const const_iterator& other) const { return row_ == other.row_; }
+        bool operator!=(const const_iterator& other) const { return row_ != other.row_; }
+
+    private:
+        void skipDead() {
+            while (row_ < store_->rows() && !store_->live_[row_]) row_++;
+        }
+
+        const TransactionStore* store_;
+        size_t row_;
+    };
+
+    TransactionStore() = default;
+    TransactionStore(TransactionStore&&) = default;
+    TransactionStore& operator=(TransactionStore&&) = default;
+
+    TransactionStore(const TransactionStore&) = default; // Secondary indexes stay behind; see LazyIndex
+    TransactionStore& operator=(const TransactionStore&) = default;
+
+    size_t size() const { return ids_.size() - dead_; } // Live transactions
+    bool empty() const { return size() == 0; }
+    size_t rows() const { return ids_.size(); }          // Including dead rows
+    size_t dead_rows() const { return dead_; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, rows()); }
+    TransactionRef operator[](size_t row) const { return TransactionRef(this, row); }
+
+    // Hot columns, one entry per row including dead ones
+    const vector<uint8_t>& live() const { return live_; }
+    const vector<int>& ids() const { return ids_; }
+    const vector<Date>& dates() const { return dates_; }
+    const vector<CategoryId>& categories() const { return categories_; }
+    const vector<Money>& amounts() const { return amounts_; }
+    const vector<char>& types() const { return types_; }
+
+    string_view description(size_t row) const {
+        return string_view(description_heap_.data() + description_offsets_[row], description_lengths_[row]);
+    }
+
+    /**
+     * Sum of live expenses in a category, kept up to date by every add, edit and delete
+     */
+    Money expense_total(CategoryId category) const {
+        return category < expense_totals_.size() ? expense_totals_[category] : Money();
+    }
+
+    /**
+     * Call visit(TransactionRef) for each live row dated from `from` to `to` inclusive, in
+     * date order, until it returns false. The first call sorts the rows by date; after that
+     * the index is maintained by every mutation and a scan touches only its window.
+     */
+    template <typename Visit>
+    void scan_dates(Date from, Date to, Visit visit) const {
+        if (!date_index_.built()) date_index_.build(dates_, live_);
+        date_index_.scan(from, to, [&](size_t row) { return visit(TransactionRef(this, row)); });
+    }
+
+    /**
+     * Call visit(TransactionRef) for each live transaction whose description or category
+     * name contains every word of `query`, ignoring case, in row order until it returns
+     * false. Words shorter than three letters must start a word. Only the candidates for
+     * the most selective word are read; the first search indexes every description.
+     */
+    template <typename Visit>
+    void search(string_view query, const CategoryDictionary& categories, Visit visit) const {
+        vector<string> terms;
+        SearchIndex::forEachWord(query, [&](const string& word) { terms.push_back(word); });
+        if (terms.empty()) return;
+        if (!search_index_.built()) {
+            search_index_.start();
+            for (size_t row = 0; row < rows(); row++) {
+                if (live_[row]) search_index_.add(row, description(row));
+            }
+        }
+
+        // Categories are few, so match their names directly
+        vector<vector<uint8_t>> in_category(terms.size(), vector<uint8_t>(categories.size()));
+        size_t best_term = 0, best_cost = SIZE_MAX;
+        bool scan_all = false;
+        for (size_t t = 0; t < terms.size(); t++) {
+            bool any_category = false;
+            for (CategoryId id = 0; id < categories.size(); id++) {
+                in_category[t][id] = SearchIndex::matches(categories.name(id), terms[t]);
+                any_category = any_category || in_category[t][id];
+            }
+            size_t cost = any_category ? rows() : search_index_.candidates(terms[t]).size();
+            if (cost < best_cost) {
+                best_term = t;
+                best_cost = cost;
+                scan_all = any_category;
+            }
+        }
+
+        auto check = [&](size_t row) { // Returns false once visit asks to stop
+            if (!live_[row]) return true;
+            for (size_t t = 0; t < terms.size(); t++) {
+                bool category_hit = categories_[row] < categories.size() && in_category[t][categories_[row]];
+                if (!category_hit && !SearchIndex::matches(description(row), terms[t])) return true;
+            }
+            return visit(TransactionRef(this, row));
+        };
+        if (scan_all) { // Every word matches some category name, so any row could qualify
+            for (size_t row = 0; row < rows(); row++) {
+                if (!check(row)) return;
+            }
+            return;
+        }
+        for (uint32_t row : search_index_.candidates(terms[best_term])) {
+            if (!check(row)) return;
+        }
+    }
+
+    /**
+     * Live rows in a category or of a type ('I' or 'E'), as bitmaps to combine with & and |
+     * before gathering the survivors with for_rows. The first call indexes every row by
+     * category and type; after that every mutation keeps the bitmaps current.
+     */
+    const RowBitmap& category_rows(CategoryId category) const {
+        if (!bitmaps_.built()) bitmaps_.build(categories_, types_, live_);
+        return bitmaps_.category(category);
+    }
+    const RowBitmap& type_rows(char type) const {
+        if (!bitmaps_.built()) bitmaps_.build(categories_, types_, live_);
+        return bitmaps_.type(type);
+    }
+
+    /** Live rows dated from `from` to `to` inclusive, as a bitmap; see scan_dates */
+    RowBitmap date_rows(Date from, Date to) const {
+        vector<uint64_t> words((rows() + 63) / 64); // Rows arrive in date order, so mark them first
+        scan_dates(from, to, [&](TransactionRef t) { words[t.row() / 64] |= uint64_t(1) << (t.row() % 64); return true; });
+        return RowBitmap::fromWords(words);
+    }
+
+    /**
+     * Call visit(TransactionRef) for each row of `rows` in row order until it returns false.
+     * The rows must come from this store since its last mutation.
+     */
+    template <typename Visit>
+    void for_rows(const RowBitmap& rows, Visit visit) const {
+        rows.for_each([&](size_t row) { return visit(TransactionRef(this, row)); });
+    }
+
+    /**
+     * Income minus expenses of live transactions dated up to and including `date`, and over
+     * the days from `from` to `to` inclusive. Undated rows are left out. The first call
+     * sums every row by day; after that both are O(log days).
+     */
+    Money balance_as_of(Date date) const {
+        if (!balance_tree_.built()) balance_tree_.build(dates_, amounts_, types_, live_);
+        return balance_tree_.through(date.days);
+    }
+    Money net_flow(Date from, Date to) const {
+        if (to < from) return Money();
+        return balance_as_of(to) - balance_as_of(Date{from.days - 1});
+    }
+
+    /** Sums of all live income and expense rows, for the running balance */
+    Money total_income() const { return total_income_; }
+    Money total_expense() const { return total_expense_; }
+
+    /**
+     * Totals of live dated transactions by month, keyed by year * 12 + month - 1.
+     * Maintained alongside expense_total; yearly figures are folded from it.
+     */
+    const PeriodRollup& monthly_totals() const { return monthly_totals_; }
+
+    void reserve(size_t n) {
+        index_.reserve(n);
+        live_.reserve(n);
+        ids_.reserve(n);
+        dates_.reserve(n);
+        categories_.reserve(n);
+        amounts_.reserve(n);
+        types_.reserve(n);
+        description_offsets_.reserve(n);
+        description_lengths_.reserve(n);
+    }
+
+    /**
+     * Add a row, or overwrite the row that already has this id
+     */
+    void append(int id, Date date, CategoryId category, Money amount, char type, string_view description) {
+        size_t row;
+        if (index_.find(id, row)) {
+            set(row, {date, category, string(description), amount, type, id});
+            return;
+        }
+        index_.insert(id, ids_.size());
+        live_.push_back(1);
+        ids_.push_back(id);
+        dates_.push_back(date);
+        categories_.push_back(category);
+        amounts_.push_back(amount);
+        types_.push_back(type);
+        description_offsets_.push_back(description_heap_.size());
+        description_lengths_.push_back(static_cast<uint32_t>(description.size()));
+        description_heap_.append(description.data(), description.size());
+        addToTotals(ids_.size() - 1);
+        bitmaps_.add(ids_.size() - 1, category, type);
+        date_index_.insert(date, ids_.size() - 1);
+        search_index_.add(ids_.size() - 1, description);
+    }
+
+    void push_back(const Transaction& t) { append(t.id, t.date, t.category, t.amount, t.type, t.description); }
+
+    Transaction get(size_t row) const {
+        return {dates_[row], categories_[row], string(description(row)), amounts_[row], types_[row], ids_[row]};
+    }
+
+    bool find(int id, size_t& row) const { return index_.find(id, row); }
+
+    /**
+     * Overwrite the transaction with t's id. Returns false if there is none.
+     */
+    bool update(const Transaction& t) {
+        size_t row;
+        if (!index_.find(t.id, row)) return false;
+        set(row, t);
+        return true;
+    }
+
+    /**
+     * Remove the transaction with this id. Returns false if there is none.
+     */
+    bool remove(int id) {
+        size_t row;
+        if (!index_.find(id, row)) return false;
+        erase(row);
+        return true;
+    }
+
+    /**
+     * Overwrite a row. A changed description is appended to the heap; the old bytes are
+     * reclaimed once garbage makes up most of the heap.
+     */
+    void set(size_t row, const Transaction& t) {
+        if (ids_[row] != t.id) {
+            size_t other;
+            if (index_.find(t.id, other)) markDead(other); // Keep ids unique: the row being written wins
+            index_.erase(ids_[row]);
+            index_.insert(t.id, row);
+        }
+        subtractFromTotals(row);
+        if (categories_[row] != t.category || types_[row] != t.type) {
+            bitmaps_.remove(row, categories_[row], types_[row]);
+            bitmaps_.add(row, t.category, t.type);
+        }
+        if (dates_[row] != t.date) {
+            date_index_.erase(dates_[row], row);
+            date_index_.insert(t.date, row);
+        }
+        ids_[row] = t.id;
+        dates_[row] = t.date;
+        categories_[row] = t.category;
+        amounts_[row] = t.amount;
+        types_[row] = t.type;
+        addToTotals(row);
+        if (description(row) != t.description) {
+            search_index_.retire(description(row));
+            search_index_.add(row, t.description);
+            if (search_index_.mostly_stale()) search_index_.clear(); // Rebuilt by the next search
+            description_garbage_ += description_lengths_[row];
+            description_offsets_[row] = description_heap_.size();
+            description_lengths_[row] = static_cast<uint32_t>(t.description.size());
+            description_heap_ += t.description;
+            maybeReclaimDescriptions();
+        }
+    }
+
+    /**
+     * Delete a live row. May compact the store, which renumbers rows.
+     */
+    void erase(size_t row) {
+        markDead(row);
+        if (dead_ >= MIN_DEAD_ROWS_TO_COMPACT && dead_ * 4 >= rows()) compact();
+    }
+
+    /**
+     * Drop dead rows, rebuilding the columns, the description heap and the id index
+     */
+    void compact() {
+        if (dead_ == 0) return;
+        size_t out = 0;
+        string heap;
+        heap.reserve(description_heap_.size() - description_garbage_);
+        vector<uint32_t> new_rows(date_index_.built() || search_index_.built() ? rows() : 0, UINT32_MAX);
+        for (size_t row = 0; row < rows(); row++) {
+            if (!live_[row]) continue;
+            if (!new_rows.empty()) new_rows[row] = static_cast<uint32_t>(out);
+            string_view text = description(row); // Read before row `out` is overwritten
+            ids_[out] = ids_[row];
+            dates_[out] = dates_[row];
+            categories_[out] = categories_[row];
+            amounts_[out] = amounts_[row];
+            types_[out] = types_[row];
+            description_offsets_[out] = heap.size();
+            description_lengths_[out] = description_lengths_[row];
+            heap.append(text.data(), text.size());
+            out++;
+        }
+        live_.assign(out, 1);
+        ids_.resize(out);
+        dates_.resize(out);
+        categories_.resize(out);
+        amounts_.resize(out);
+        types_.resize(out);
+        description_offsets_.resize(out);
+        description_lengths_.resize(out);
+        description_heap_ = move(heap);
+        description_garbage_ = 0;
+        dead_ = 0;
+
+        index_ = IdIndex();
+        index_.reserve(out);
+        for (size_t row = 0; row < out; row++) index_.insert(ids_[row], row);
+        date_index_.renumber(new_rows);
+        search_index_.renumber(new_rows);
+        bitmaps_.clear(); // Cheaper to rebuild on the next filter than to renumber
+    }
+
+private:
+    static constexpr size_t MIN_DEAD_ROWS_TO_COMPACT = 1024;
+
+    void markDead(size_t row) {
+        if (!live_[row]) return;
+        subtractFromTotals(row);
+        bitmaps_.remove(row, categories_[row], types_[row]);
+        date_index_.erase(dates_[row], row);
+        search_index_.retire(description(row));
+        if (search_index_.mostly_stale()) search_index_.clear();
+        index_.erase(ids_[row]);
+        live_[row] = 0;
+        amounts_[row] = Money();
+        types_[row] = '\0';
+        description_garbage_ += description_lengths_[row];
+        description_lengths_[row] = 0;
+        dead_++;
+        maybeReclaimDescriptions();
+    }
+
+    void addToTotals(size_t row) {
+        if (types_[row] == 'E') {
+            CategoryId category = categories_[row];
+            if (category >= expense_totals_.size()) expense_totals_.resize(category + 1);
+            expense_totals_[category] += amounts_[row];
+            total_expense_ += amounts_[row];
+        } else if (types_[row] == 'I') {
+            total_income_ += amounts_[row];
+        }
+        updatePeriods(row, true);
+        balance_tree_.add(dates_[row], types_[row], amounts_[row], true);
+    }
+
+    void subtractFromTotals(size_t row) {
+        if (types_[row] == 'E') {
+            expense_totals_[categories_[row]] -= amounts_[row];
+            total_expense_ -= amounts_[row];
+        } else if (types_[row] == 'I') {
+            total_income_ -= amounts_[row];
+        }
+        updatePeriods(row, false);
+        balance_tree_.add(dates_[row], types_[row], amounts_[row], false);
+    }
+
+    void updatePeriods(size_t row, bool adding) {
+        if (!dates_[row].valid()) return;
+        int32_t days = dates_[row].days;
+        if (days < period_first_day_ || days >= period_end_day_) {
+            // Rows usually arrive grouped by month, so the calendar maths runs once per month
+            int64_t year;
+            unsigned month, day;
+            civilFromDays(days, year, month, day);
+            period_first_day_ = days - static_cast<int32_t>(day) + 1;
+            period_end_day_ = static_cast<int32_t>(daysFromCivil(month == 12 ? year + 1 : year, month % 12 + 1, 1));
+            period_month_ = year * 12 + month - 1;
+        }
+        if (adding) monthly_totals_.add(period_month_, types_[row], amounts_[row]);
+        else monthly_totals_.subtract(period_month_, types_[row], amounts_[row]);
+    }
+
+    void maybeReclaimDescriptions() {
+        if (description_garbage_ < 4096 || description_garbage_ * 2 < description_heap_.size()) return;
+        string heap;
+        heap.reserve(description_heap_.size() - description_garbage_);
+        for (size_t row = 0; row < rows(); row++) {
+            string_view text = description(row);
+            description_offsets_[row] = heap.size();
+            heap.append(text.data(), text.size());
+        }
+        description_heap_ = move(heap);
+        description_garbage_ = 0;
+    }
+
+    IdIndex index_;
+    mutable LazyIndex<DateIndex> date_index_;       // Built by the first scan_dates
+    mutable LazyIndex<BalanceTree> balance_tree_;   // Built by the first balance_as_of
+    mutable LazyIndex<SearchIndex> search_index_;   // Built by the first search
+    mutable LazyIndex<BitmapIndex> bitmaps_;        // Built by the first category_rows or type_rows
+    vector<uint8_t> live_;
+    vector<int> ids_;
+    vector<Date> dates_;
+    vector<CategoryId> categories_;
+    vector<Money> amounts_;
+    vector<char> types_;
+    vector<size_t> description_offsets_; // Into description_heap_
+    vector<uint32_t> description_lengths_;
+    string description_heap_;
+    size_t description_garbage_ = 0;     // Heap bytes no longer referenced by any row
+    size_t dead_ = 0;
+    vector<Money> expense_totals_;       // By CategoryId, live rows only
+    Money total_income_;
+    Money total_expense_;
+    PeriodRollup monthly_totals_;
+    int32_t period_first_day_ = 0;       // Month of the last row added to the rollups
+    int32_t period_end_day_ = 0;
+    int64_t period_month_ = 0;
+};
+
+inline int TransactionRef::id() const { return store_->ids()[row_]; }
+inline Date TransactionRef::date() const { return store_->dates()[row_]; }
+inline CategoryId TransactionRef::category() const { return store_->categories()[row_]; }
+inline Money TransactionRef::amount() const { return store_->amounts()[row_]; }
+inline char TransactionRef::type() const { return store_->types()[row_]; }
+inline string_view TransactionRef::description() const { return store_->description(row_); }
+inline Transaction TransactionRef::value() const { return store_->get(row_); }
+
+/**
+ * `store` itself if it has no dead rows, otherwise a compacted copy made in `scratch`.
+ * Lets writers walk the columns without checking live().
+ */
+const TransactionStore& withoutDeadRows(const TransactionStore& store, TransactionStore& scratch) {
+    if (store.dead_rows() == 0) return store;
+    scratch = store;
+    scratch.compact();
+    return scratch;
+}
+
+struct UserProfile {
+    string username;
+    string password; // Added for security
+    TransactionStore transactions;
+    map<string, Money> budgetPerCategory;
+    CategoryDictionary categories = {}; // Names for Transaction::category
+    int next_transaction_id = 1; // To ensure unique transaction IDs
+    bool data_loaded = false;    // Transactions and budgets are read from disk on login
+    bool dirty = false;          // Changed since its snapshot was last written
+    size_t journal_records = 0;  // Records in this user's journal since its last snapshot
+    size_t journal_bytes = 0;    // Size of this user's journal
+};
+
+/**
+ * Every registered user, indexed by username. Profiles live in a deque, which never moves
+ * existing elements when appending, so a UserProfile* handed out by find() or add() stays
+ * valid for the registry's lifetime. Registering a user no longer copies everyone else's
+ * transactions or leaves g_current_user dangling.
+ */
+class UserRegistry {
+public:
+    using iterator = deque<UserProfile>::iterator;
+    using const_iterator = deque<UserProfile>::const_iterator;
+
+    UserRegistry() = default;
+    UserRegistry(const UserRegistry&) = delete; // The index points into users_
+    UserRegistry& operator=(const UserRegistry&) = delete;
+    UserRegistry(UserRegistry&&) = default;     // Moving a deque keeps its elements in place
+    UserRegistry& operator=(UserRegistry&&) = default;
+
+    /** The user with this name, or nullptr. */
+    UserProfile* find(const string& username) {
+        auto it = by_name_.find(username);
+        return it == by_name_.end() ? nullptr : it->second;
+    }
+    const UserProfile* find(const string& username) const {
+        auto it = by_name_.find(username);
+        return it == by_name_.end() ? nullptr : it->second;
+    }
+
+    /**
+     * Register a user with a single hash lookup. Returns nullptr, leaving the registry
+     * unchanged, if the username is already taken.
+     */
+    UserProfile* add(UserProfile user) {
+        auto [slot, inserted] = by_name_.try_emplace(user.username, nullptr);
+        if (!inserted) return nullptr;
+        users_.push_back(move(user));
+        slot->second = &users_.back();
+        return slot->second;
+    }
+
+    void clear() {
+        by_name_.clear();
+        users_.clear();
+    }
+
+    size_t size() const { return users_.size(); }
+    bool empty() const { return users_.empty(); }
+    UserProfile& operator[](size_t i) { return users_[i]; } // In registration order
+    const UserProfile& operator[](size_t i) const { return users_[i]; }
+    iterator begin() { return users_.begin(); }
+    iterator end() { return users_.end(); }
+    const_iterator begin() const { return users_.begin(); }
+    const_iterator end() const { return users_.end(); }
+
+private:
+    deque<UserProfile> users_;
+    unordered_map<string, UserProfile*> by_name_;
+};
+
+// Forward declarations for journal functions (defined under File Management)
+void journalRegisterUser(const UserProfile& user);
+void journalAddTransaction(UserProfile& user, const Transaction& t);
+void journalEditTransaction(UserProfile& user, const Transaction& t);
+void journalDeleteTransaction(UserProfile& user, int id);
+void journalSetBudget(UserProfile& user, const string& category, Money amount);
+
+// --- Aggregation Kernels ---
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/** Sums of the income ('I') and expense ('E') rows of a column run */
+struct TypeSums {
+    Money income;
+    Money expense;
+};
+
+/**
+ * One instruction-set level of the income/expense column sum. Only the --check-totals
+ * rescan (findTotalsMismatch) and --bench-aggregate call these: a normal run reads the
+ * running totals instead. Every level returns exactly the scalar result, since the sums
+ * are whole cents and lane order does not matter.
+ */
+struct AggregationKernels {
+    const char* name;
+    TypeSums (*sum_by_type)(const Money* amounts, const char* types, size_t n);
+};
+
+enum class SimdLevel { Scalar, Sse42, Avx2, Avx512 };
+
+TypeSums sumByTypeScalar(const Money* amounts, const char* types, size_t n) {
+    TypeSums sums;
+    for (size_t i = 0; i < n; i++) {
+        sums.income.cents += amounts[i].cents & -int64_t(types[i] == 'I');
+        sums.expense.cents += amounts[i].cents & -int64_t(types[i] == 'E');
+    }
+    return sums;
+}
+
+/**
+ * Add each expense row's amount to sums[category]. Left scalar: it keeps up with memory
+ * bandwidth, and comparing a vector against each category measured slower from six up.
+ */
+void sumExpensesByCategory(const Money* amounts, const char* types, const CategoryId* categories, size_t n, Money* sums) {
+    for (size_t i = 0; i < n; i++) sums[categories[i]].cents += amounts[i].cents & -int64_t(types[i] == 'E');
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("sse4.2"))) TypeSums sumByTypeSse42(const Money* amounts, const char* types, size_t n) {
+    const __m128i income_tag = _mm_set1_epi64x('I'), expense_tag = _mm_set1_epi64x('E');
+    __m128i income = _mm_setzero_si128(), expense = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t tags;
+        memcpy(&tags, types + i, 4);
+        __m128i four = _mm_cvtsi32_si128(tags);
+        for (int half = 0; half < 2; half++) {
+            __m128i type = _mm_cvtepi8_epi64(half ? _mm_srli_si128(four, 2) : four);
+            __m128i amount = _mm_loadu_si128(reinterpret_cast<const __m128i*>(amounts + i + 2 * half));
+            income = _mm_add_epi64(income, _mm_and_si128(amount, _mm_cmpeq_epi64(type, income_tag)));
+            expense = _mm_add_epi64(expense, _mm_and_si128(amount, _mm_cmpeq_epi64(type, expense_tag)));
+        }
+    }
+    TypeSums sums = sumByTypeScalar(amounts + i, types + i, n - i);
+    sums.income.cents += _mm_extract_epi64(income, 0) + _mm_extract_epi64(income, 1);
+    sums.expense.cents += _mm_extract_epi64(expense, 0) + _mm_extract_epi64(expense, 1);
+    return sums;
+}
+
+__attribute__((target("avx2"))) TypeSums sumByTypeAvx2(const Money* amounts, const char* types, size_t n) {
+    const __m256i income_tag = _mm256_set1_epi64x('I'), expense_tag = _mm256_set1_epi64x('E');
+    __m256i income = _mm256_setzero_si256(), expense = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i eight = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(types + i));
+        for (int half = 0; half < 2; half++) {
+            __m256i type = _mm256_cvtepi8_epi64(half ? _mm_srli_si128(eight, 4) : eight);
+            __m256i amount = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(amounts + i + 4 * half));
+            income = _mm256_add_epi64(income, _mm256_and_si256(amount, _mm256_cmpeq_epi64(type, income_tag)));
+            expense = _mm256_add_epi64(expense, _mm256_and_si256(amount, _mm256_cmpeq_epi64(type, expense_tag)));
+        }
+    }
+    alignas(32) int64_t lanes[2][4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), income);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), expense);
+    TypeSums sums = sumByTypeScalar(amounts + i, types + i, n - i);
+    sums.income.cents += lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+    sums.expense.cents += lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+    return sums;
+}
+
+__attribute__((target("avx512f"))) TypeSums sumByTypeAvx512(const Money* amounts, const char* types, size_t n) {
+    const __m512i income_tag = _mm512_set1_epi64('I'), expense_tag = _mm512_set1_epi64('E');
+    __m512i income = _mm512_setzero_si512(), expense = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i sixteen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(types + i));
+        for (int half = 0; half < 2; half++) {
+            // The maskz form avoids the undefined source register GCC warns about
+            __m512i type = _mm512_maskz_cvtepi8_epi64(0xFF, half ? _mm_srli_si128(sixteen, 8) : sixteen);
+            __m512i amount = _mm512_loadu_si512(amounts + i + 8 * half);
+            income = _mm512_mask_add_epi64(income, _mm512_cmpeq_epi64_mask(type, income_tag), income, amount);
+            expense = _mm512_mask_add_epi64(expense, _mm512_cmpeq_epi64_mask(type, expense_tag), expense, amount);
+        }
+    }
+    alignas(64) int64_t lanes[2][8];
+    _mm512_store_si512(lanes[0], income);
+    _mm512_store_si512(lanes[1], expense);
+    TypeSums sums = sumByTypeScalar(amounts + i, types + i, n - i);
+    for (int lane = 0; lane < 8; lane++) {
+        sums.income.cents += lanes[0][lane];
+        sums.expense.cents += lanes[1][lane];
+    }
+    return sums;
+}
+
+#endif
+
+/**
+ * The widest instruction set this CPU and OS support, detected once. Builds for other
+ * architectures or compilers only have the scalar kernels.
+ */
+SimdLevel detectSimdLevel() {
+#ifdef HAVE_X86_KERNELS
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("sse4.2")) return SimdLevel::Sse42;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+/**
+ * Kernels for `level`, falling back to the widest this CPU supports below it
+ */
+const AggregationKernels& aggregationKernels(SimdLevel level = detectSimdLevel()) {
+    static const AggregationKernels scalar{"scalar", sumByTypeScalar};
+#ifdef HAVE_X86_KERNELS
+    static const AggregationKernels sse42{"SSE4.2", sumByTypeSse42};
+    static const AggregationKernels avx2{"AVX2", sumByTypeAvx2};
+    static const AggregationKernels avx512{"AVX-512", sumByTypeAvx512};
+    level = min(level, detectSimdLevel());
+    if (level == SimdLevel::Avx512) return avx512;
+    if (level == SimdLevel::Avx2) return avx2;
+    if (level == SimdLevel::Sse42) return sse42;
+#endif
+    (void)level;
+    return scalar;
+}
+
+// --- Global Variables (for UI context) ---
+UserProfile* g_current_user = nullptr; // Pointer to the currently logged-in user
+UserRegistry g_users;                  // All registered users; transactions only for those logged in
+bool g_check_totals = false;           // --check-totals: rescan the user's running totals after every change
+
+// --- Utility Functions ---
+
+/**
+ * Draw text centered horizontally on the screen at specified vertical position
+ */
+void draw_text_centered(const string &text, int y, color clr = COLOR_BLACK) {
+    if (!has_font("default_font"))
+        load_font("default_font", "arial.ttf");
+    font fnt = font_named("default_font");
+    int w = text_width(text, "default_font", 20);
+    int x = (screen_width() - w) / 2;
+    draw_text(text, clr, "default_font", 20, x, y);
+}
+
+/**
+ * Format an amount as a string with two decimal places
+ */
+string format_amount(Money amount) {
+    uint64_t magnitude = amount.cents < 0 ? 0 - static_cast<uint64_t>(amount.cents) : static_cast<uint64_t>(amount.cents);
+    uint64_t fraction = magnitude % 100;
+    return (amount.cents < 0 ? "-" : "") + to_string(magnitude / 100) + "." + char('0' + fraction / 10) + char('0' + fraction % 10);
+}
+
+/**
+ * Convert a float amount from an older file to the nearest cent
+ */
+Money moneyFromFloat(double amount) {
+    return Money{llround(amount * 100.0)};
+}
+
+/**
+ * Parse an amount such as "12", "-3.5" or "1234.56" exactly, rounding anything past
+ * the cents half away from zero. Exponent forms written by older versions (e.g.
+ * "1.5e+06") are read as floating point and rounded to the nearest cent.
+ * Returns false for anything else or for amounts too large to hold.
+ */
+bool parseMoney(string_view text, Money& amount) {
+    while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+
+    string_view digits = text;
+    bool negative = !digits.empty() && digits.front() == '-';
+    if (!digits.empty() && (digits.front() == '-' || digits.front() == '+')) digits.remove_prefix(1);
+
+    const int64_t max_units = INT64_MAX / 100 - 1;
+    int64_t units = 0;
+    size_t i = 0, whole_digits = 0, fraction_digits = 0;
+    for (; i < digits.size() && isdigit(static_cast<unsigned char>(digits[i])); i++, whole_digits++) {
+        units = units * 10 + (digits[i] - '0');
+        if (units > max_units) return false;
+    }
+    int64_t cents = units * 100;
+    if (i < digits.size() && digits[i] == '.') {
+        int64_t scale = 10;
+        for (i++; i < digits.size() && isdigit(static_cast<unsigned char>(digits[i])); i++, fraction_digits++) {
+            int digit = digits[i] - '0';
+            if (fraction_digits < 2) cents += digit * scale;
+            else if (fraction_digits == 2 && digit >= 5) cents++;
+            scale /= 10;
+        }
+    }
+    if (i == digits.size() && whole_digits + fraction_digits > 0) {
+        amount.cents = negative ? -cents : cents;
+        return true;
+    }
+
+    double value;
+    auto result = from_chars(text.data() + (!text.empty() && text.front() == '+'), text.data() + text.size(), value);
+    if (result.ec != errc() || result.ptr != text.data() + text.size()) return false;
+    if (!(fabs(value) < static_cast<double>(max_units))) return false;
+    amount = moneyFromFloat(value);
+    return true;
+}
+
+/**
+ * Draw a menu item at given coordinates with specified color
+ */
+void draw_menu_item(const string &text, int x, int y, color clr = COLOR_BLACK) {
+    draw_text(text, clr, x, y);
+}
+
+/**
+ * Wait for a mouse left button click to continue
+ * Shows a prompt and then blocks until user clicks anywhere on screen
+ */
+void wait_for_mouse_click_to_return() {
+    draw_text_centered("Click anywhere to return", screen_height() - 50);
+    refresh_screen();
+
+    while (!quit_requested()) {
+        process_events();
+        if (mouse_clicked(LEFT_BUTTON)) return;
+        delay(10); // Prevent busy-waiting
+    }
+}
+
+/**
+ * Days since 1970-01-01 for a proleptic Gregorian date
+ */
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+/**
+ * Inverse of daysFromCivil
+ */
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+/**
+ * Parse a YYYY-MM-DD date (single-digit months and days are accepted).
+ * Returns false for anything that is not a real calendar date.
+ */
+bool parse_date(string_view text, Date& date) {
+    size_t first = text.find('-');
+    size_t second = first == string_view::npos ? first : text.find('-', first + 1);
+    if (second == string_view::npos) return false;
+
+    auto number = [](string_view field, size_t max_digits, int& value) {
+        if (field.empty() || field.size() > max_digits) return false;
+        if (!all_of(field.begin(), field.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) return false;
+        from_chars(field.data(), field.data() + field.size(), value);
+        return true;
+    };
+    int year, month, day;
+    if (!number(text.substr(0, first), 4, year) || !number(text.substr(first + 1, second - first - 1), 2, month) ||
+        !number(text.substr(second + 1), 2, day)) return false;
+
+    static const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (month < 1 || month > 12 || day < 1 || day > month_days[month - 1] + (month == 2 && leap)) return false;
+    date.days = static_cast<int32_t>(daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)));
+    return true;
+}
+
+/**
+ * Format a date as YYYY-MM-DD, or an empty string if it is missing
+ */
+string format_date(Date date) {
+    if (!date.valid()) return "";
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(date.days, y, m, d);
+    unsigned year = static_cast<unsigned>(y);
+    char buf[10] = {char('0' + year / 1000), char('0' + year / 100 % 10), char('0' + year / 10 % 10), char('0' + year % 10), '-',
+                    char('0' + m / 10), char('0' + m % 10), '-', char('0' + d / 10), char('0' + d % 10)};
+    return string(buf, sizeof(buf));
+}
+
+// --- UI Interaction Functions ---
+
+/**
+ * Draw a clickable button
+ */
+void draw_button(const string& text, float x, float y, float width, float height, color btn_clr, color txt_clr) {
+    fill_rectangle(btn_clr, x, y, width, height);
+    draw_rectangle(COLOR_BLACK, x, y, width, height); // Border
+    draw_text(text, txt_clr, x + (width - text_width(text, "default_font", 16)) / 2, y + (height - text_height("Tg", "default_font", 16)) / 2);
+}
+
+/**
+ * Check if a button is clicked
+ */
+bool is_button_clicked(float x, float y, float width, float height) {
+    return mouse_clicked(LEFT_BUTTON) && point_in_rectangle(mouse_position(), rectangle_from(x, y, width, height));
+}
+
+/**
+ * Get text input from user via SplashKit window.
+ * Returns empty string if user cancels (e.g., presses ESC).
+ * This function clears the screen for input and draws its own prompt.
+ */
+string get_text_input(const string& prompt, float x_input, float y_input, float width, float height) {
+    string input = "";
+    bool done = false;
+
+    // Clear screen once at the beginning of this input session
+    clear_screen(COLOR_WHITE);
+
+    // Draw static prompt and instructions
+    draw_text_centered(prompt, y_input - 50);
+    draw_text("Press ENTER to confirm, ESC to cancel", COLOR_GRAY, x_input, y_input + height + 10);
+
+    while (!quit_requested() && !done) {
+        process_events();
+
+        // Clear the input box area before redrawing to prevent residue
+        // This ensures the blinking cursor and input text are drawn cleanly each frame
+        fill_rectangle(COLOR_WHITE, x_input - 5, y_input - 5, width + 10, height + 10);
+        draw_rectangle(COLOR_BLACK, x_input - 5, y_input - 5, width + 10, height + 10); // Input box border
+
+        // Draw input text with blinking cursor
+        if (static_cast<int>(current_ticks() / 500) % 2 == 0) {
+            draw_text(input + "|", COLOR_BLACK, x_input, y_input);
+        } else {
+            draw_text(input, COLOR_BLACK, x_input, y_input);
+        }
+        
+        refresh_screen();
+
+        if (key_typed(RETURN_KEY)) {
+            done = true;
+        } else if (key_typed(ESCAPE_KEY)) {
+            return ""; // Cancelled
+        } else if (key_typed(BACKSPACE_KEY)) {
+            if (!input.empty()) {
+                input.pop_back();
+            }
+        } else {
+            // Check all possible key codes for printable characters
+            for (int k = 32; k <= 126; ++k) { // ASCII printable range
+                if (key_typed(static_cast<key_code>(k))) {
+                    char key_char = static_cast<char>(k);
+                    input += key_char;
+                }
+            }
+        }
+        delay(10);
+    }
+    return input;
+}
+
+
+// --- Transaction Management ---
+
+/**
+ * Add a new transaction via UI input
+ */
+void add_transaction_ui(UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Add New Transaction ---", 50);
+
+    string date_str = get_text_input("Enter Date (YYYY-MM-DD):", 200, 100, 400, 30);
+    if (date_str.empty()) return;
+
+    Date date;
+    if (!parse_date(date_str, date)) {
+        clear_screen(COLOR_WHITE); // Clear before showing error
+        draw_text_centered("Invalid date. Please use YYYY-MM-DD.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+
+    string category = get_text_input("Enter Category:", 200, 150, 400, 30);
+    if (category.empty()) return;
+
+    string description = get_text_input("Enter Description:", 200, 200, 400, 30);
+    if (description.empty()) return;
+
+    string amount_str = get_text_input("Enter Amount (number):", 200, 250, 400, 30);
+    if (amount_str.empty()) return;
+
+    Money amount;
+    if (!parseMoney(amount_str, amount)) {
+        clear_screen(COLOR_WHITE); // Clear before showing error
+        draw_text_centered("Invalid amount. Please enter a valid number.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+
+    string type_str = get_text_input("Enter Type (I for Income, E for Expense):", 200, 300, 400, 30);
+    if (type_str.empty() || (toupper(type_str[0]) != 'I' && toupper(type_str[0]) != 'E')) {
+        clear_screen(COLOR_WHITE); // Clear before showing error
+        draw_text_centered("Invalid type. Must be 'I' or 'E'.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+    char type = toupper(type_str[0]);
+
+    Transaction t{date, user.categories.intern(category), description, amount, type, user.next_transaction_id++};
+    user.transactions.push_back(t);
+    journalAddTransaction(user, t);
+    user.dirty = true;
+    clear_screen(COLOR_WHITE); // Clear before showing success
+    draw_text_centered("Transaction added successfully!", screen_height() / 2);
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * One row of a transaction listing, matching the header drawn by draw_transaction_header
+ */
+string format_transaction_line(const UserProfile& user, TransactionRef t) {
+    return to_string(t.id()) + " | " + format_date(t.date()) + " | " + user.categories.name(t.category()) + " | " + string(t.description().substr(0, 25)) + (t.description().length() > 25 ? "..." : "") + " | " + (t.type() == 'I' ? "Income" : "Expense") + " | $" + format_amount(t.amount());
+}
+
+/**
+ * Draw the column header of a transaction listing at y. Returns the y of the first row.
+ */
+int draw_transaction_header(int y) {
+    draw_text("ID | Date       | Category  | Description                | Type   | Amount", COLOR_BLACK, 20, y);
+    y += 25;
+    draw_line(COLOR_BLACK, 15, y, screen_width() - 15, y);
+    return y + 10;
+}
+
+/**
+ * Display all transactions on screen.
+ * If categoryFilter is provided (non-empty), only show transactions of that category.
+ * If from and to are given, only show transactions dated between them, in date order.
+ */
+void draw_transactions(const UserProfile& user, const string& categoryFilter = "", Date from = Date(), Date to = Date()) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Transactions ---", 20);
+
+    int y = draw_transaction_header(60);
+
+    CategoryId filter_id = 0;
+    bool filter_known = user.categories.find(categoryFilter, filter_id);
+    auto draw_row = [&](TransactionRef t) { // Returns false once the screen is full
+        if (!categoryFilter.empty() && (!filter_known || t.category() != filter_id)) return true;
+
+        draw_text(format_transaction_line(user, t), COLOR_BLACK, 20, y);
+        y += 25;
+        if (y > screen_height() - 80) { // Leave space for "Click to return"
+            draw_text_centered("... (More transactions below) ...", y);
+            return false;
+        }
+        return true;
+    };
+    if (from.valid() && to.valid()) {
+        user.transactions.scan_dates(from, to, draw_row); // Touches only the requested window
+    } else if (!categoryFilter.empty()) {
+        if (filter_known) user.transactions.for_rows(user.transactions.category_rows(filter_id), draw_row);
+    } else {
+        for (const auto t : user.transactions) {
+            if (!draw_row(t)) break;
+        }
+    }
+
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * Prompt for a start and end date below a screen title. Returns false if the user
+ * cancelled or entered an invalid date (after telling them).
+ */
+bool get_date_range_input(const string& title, Date& from, Date& to) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered(title, 50);
+
+    string from_str = get_text_input("Enter Start Date (YYYY-MM-DD):", 200, 100, 400, 30);
+    if (from_str.empty()) return false;
+    string to_str = get_text_input("Enter End Date (YYYY-MM-DD):", 200, 150, 400, 30);
+    if (to_str.empty()) return false;
+
+    if (!parse_date(from_str, from) || !parse_date(to_str, to)) {
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("Invalid date. Please use YYYY-MM-DD.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return false;
+    }
+    if (to < from) swap(from, to); // Accept the range either way round
+    return true;
+}
+
+/**
+ * Ask for a date range and display the transactions dated within it
+ */
+void view_transactions_by_date_ui(const UserProfile& user) {
+    Date from, to;
+    if (!get_date_range_input("--- Transactions by Date ---", from, to)) return;
+    draw_transactions(user, "", from, to);
+}
+
+/**
+ * Ask for search words and list the transactions whose description or category contains
+ * all of them. Backed by the search index, so only candidate rows are examined.
+ */
+void search_transactions_ui(const UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Search Transactions ---", 50);
+
+    string query = get_text_input("Enter search words:", 200, 100, 400, 30);
+    if (query.empty()) return;
+
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Search: " + query + " ---", 20);
+    int y = draw_transaction_header(85);
+
+    auto start = chrono::steady_clock::now();
+    size_t shown = 0;
+    bool more = false;
+    user.transactions.search(query, user.categories, [&](TransactionRef t) {
+        if (y > screen_height() - 80) { // Leave space for "Click to return"
+            more = true;
+            return false;
+        }
+        draw_text(format_transaction_line(user, t), COLOR_BLACK, 20, y);
+        y += 25;
+        shown++;
+        return true;
+    });
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    ostringstream status;
+    status << shown << (more ? "+" : "") << " matching transaction" << (shown == 1 && !more ? "" : "s") << " (" << fixed << setprecision(1) << ms << " ms)";
+    draw_text(status.str(), shown == 0 ? COLOR_RED : COLOR_BLACK, 20, 55);
+    if (more) draw_text_centered("... (More matches below; refine the search) ...", y);
+
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * Ask for categories, a type and a date range, each optional, then list the matching
+ * transactions under their totals. Each condition is a bitmap of rows: the categories are
+ * ORed together and ANDed with the type and dates, so only matching rows are read.
+ */
+void filter_transactions_ui(const UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Filter Transactions ---", 50);
+
+    string categories_str = get_text_input("Categories, comma separated (blank for all):", 200, 100, 400, 30);
+    vector<string> category_names;
+    stringstream ss(categories_str);
+    for (string name; getline(ss, name, ','); ) {
+        size_t first = name.find_first_not_of(' ');
+        if (first != string::npos) category_names.push_back(name.substr(first, name.find_last_not_of(' ') - first + 1));
+    }
+    if (!categories_str.empty() && category_names.empty()) { // Only commas and spaces
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("No category names entered. Leave it blank for all categories.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+    string type_str = get_text_input("Type (I for Income, E for Expense, blank for both):", 200, 150, 400, 30);
+    if (!type_str.empty() && toupper(type_str[0]) != 'I' && toupper(type_str[0]) != 'E') {
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("Invalid type. Must be 'I', 'E' or blank.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+    string from_str = get_text_input("Start Date (YYYY-MM-DD, blank for any):", 200, 200, 400, 30);
+    string to_str = from_str.empty() ? "" : get_text_input("End Date (YYYY-MM-DD):", 200, 250, 400, 30);
+    Date from, to;
+    if (!from_str.empty() && (!parse_date(from_str, from) || !parse_date(to_str, to))) {
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("Invalid date. Please use YYYY-MM-DD.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+    if (to < from) swap(from, to);
+
+    const TransactionStore& transactions = user.transactions;
+    auto start = chrono::steady_clock::now();
+    RowBitmap rows;
+    string description;
+    if (category_names.empty()) {
+        rows = transactions.type_rows('I') | transactions.type_rows('E');
+    }
+    for (const string& name : category_names) {
+        CategoryId id;
+        if (user.categories.find(name, id)) rows |= transactions.category_rows(id);
+        description += (description.empty() ? "" : " or ") + name;
+    }
+    if (!type_str.empty()) {
+        char type = static_cast<char>(toupper(type_str[0]));
+        rows &= transactions.type_rows(type);
+        description += string(description.empty() ? "" : " ") + (type == 'I' ? "income" : "expenses");
+    }
+    if (from.valid()) {
+        rows &= transactions.date_rows(from, to);
+        description += (description.empty() ? "" : " ") + string("from ") + format_date(from) + " to " + format_date(to);
+    }
+
+    // Gather the totals first, then draw as many rows as fit
+    Money income, expense;
+    size_t count = 0;
+    transactions.for_rows(rows, [&](TransactionRef t) {
+        if (t.type() == 'I') income += t.amount();
+        else expense += t.amount();
+        count++;
+        return true;
+    });
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- " + (description.empty() ? string("All transactions") : description) + " ---", 20);
+    ostringstream status;
+    status << count << " transaction" << (count == 1 ? "" : "s") << ", income $" << format_amount(income) << ", expenses $" << format_amount(expense) << " (" << fixed << setprecision(1) << ms << " ms)";
+    draw_text(status.str(), count == 0 ? COLOR_RED : COLOR_BLACK, 20, 55);
+    int y = draw_transaction_header(85);
+    size_t shown = 0;
+    transactions.for_rows(rows, [&](TransactionRef t) {
+        if (y > screen_height() - 80) return false; // Leave space for "Click to return"
+        draw_text(format_transaction_line(user, t), COLOR_BLACK, 20, y);
+        y += 25;
+        shown++;
+        return true;
+    });
+    if (shown < count) draw_text_centered("... (" + to_string(count - shown) + " more; narrow the filter) ...", y);
+
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * Ask for a date range, then chart the balance across it and show its net flow.
+ * Every figure is a prefix-sum query, so the cost does not depend on history size.
+ */
+void balance_history_ui(const UserProfile& user) {
+    Date from, to;
+    if (!get_date_range_input("--- Balance History ---", from, to)) return;
+
+    const TransactionStore& transactions = user.transactions;
+    Money opening = transactions.balance_as_of(Date{from.days - 1});
+    Money closing = transactions.balance_as_of(to);
+
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Balance History ---", 20);
+    draw_text("Balance before " + format_date(from) + ": $" + format_amount(opening), COLOR_BLACK, 50, 60);
+    draw_text("Balance on " + format_date(to) + ": $" + format_amount(closing), COLOR_BLACK, 50, 85);
+    draw_text("Net flow over the period: $" + format_amount(transactions.net_flow(from, to)), COLOR_BLUE, 50, 110);
+
+    // Balance at evenly spaced days, always including both ends
+    const int max_points = 60;
+    int64_t span = int64_t(to.days) - from.days;
+    int points = static_cast<int>(min<int64_t>(span + 1, max_points));
+    vector<Money> balances;
+    Money low = Money(), high = Money(); // Keep zero on the chart
+    for (int i = 0; i < points; i++) {
+        int32_t day = points == 1 ? to.days : static_cast<int32_t>(from.days + span * i / (points - 1));
+        balances.push_back(transactions.balance_as_of(Date{day}));
+        low = min(low, balances.back());
+        high = max(high, balances.back());
+    }
+
+    const float chart_x = 100, chart_y = 160, chart_width = screen_width() - 150, chart_height = screen_height() - 260;
+    auto y_of = [&](Money amount) {
+        if (high == low) return chart_y + chart_height / 2;
+        return chart_y + chart_height * static_cast<float>(high.cents - amount.cents) / static_cast<float>(high.cents - low.cents);
+    };
+    draw_rectangle(COLOR_LIGHT_GRAY, chart_x, chart_y, chart_width, chart_height);
+    draw_line(COLOR_GRAY, chart_x, y_of(Money()), chart_x + chart_width, y_of(Money())); // Zero line
+    for (int i = 1; i < points; i++) {
+        float x0 = chart_x + chart_width * (i - 1) / (points - 1);
+        float x1 = chart_x + chart_width * i / (points - 1);
+        draw_line(COLOR_BLUE, x0, y_of(balances[i - 1]), x1, y_of(balances[i]));
+    }
+    draw_text("$" + format_amount(high), COLOR_BLACK, 10, chart_y);
+    draw_text("$" + format_amount(low), COLOR_BLACK, 10, chart_y + chart_height - 15);
+    draw_text(format_date(from), COLOR_BLACK, chart_x, chart_y + chart_height + 5);
+    draw_text(format_date(to), COLOR_BLACK, chart_x + chart_width - 80, chart_y + chart_height + 5);
+
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * Edit or Delete a transaction
+ */
+void edit_delete_transaction_ui(UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Edit/Delete Transaction ---", 50);
+
+    // Show transactions to help user choose
+    draw_transactions(user); 
+
+    // Re-draw the header for edit/delete screen after view
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Edit/Delete Transaction ---", 50);
+
+    string id_str = get_text_input("Enter ID of transaction to edit/delete:", 200, 100, 400, 30);
+    if (id_str.empty()) return;
+
+    int id_to_find;
+    try {
+        id_to_find = stoi(id_str);
+    } catch (...) {
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("Invalid ID.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+
+    size_t row;
+    if (!user.transactions.find(id_to_find, row)) {
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("Transaction with ID " + id_str + " not found.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+
+    // Found transaction, now give options
+    Transaction t = user.transactions.get(row);
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("Transaction found:", 50);
+    draw_text("ID: " + to_string(t.id), COLOR_BLACK, 50, 100);
+    draw_text("Date: " + format_date(t.date), COLOR_BLACK, 50, 120);
+    draw_text("Category: " + user.categories.name(t.category), COLOR_BLACK, 50, 140);
+    draw_text("Description: " + t.description, COLOR_BLACK, 50, 160);
+    draw_text("Amount: $" + format_amount(t.amount), COLOR_BLACK, 50, 180);
+    draw_text("Type: " + std::string(t.type == 'I' ? "Income" : "Expense"), COLOR_BLACK, 50, 200);
+
+    float btn_width = 100;
+    float btn_height = 40;
+    float btn_spacing = 20;
+    float start_x = (screen_width() - (btn_width * 3 + btn_spacing * 2)) / 2; // Center the group of buttons
+
+    draw_button("Edit", start_x, 250, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+    draw_button("Delete", start_x + btn_width + btn_spacing, 250, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+    draw_button("Cancel", start_x + 2 * (btn_width + btn_spacing), 250, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+    refresh_screen();
+
+    while (!quit_requested()) {
+        process_events();
+        if (is_button_clicked(start_x, 250, btn_width, btn_height)) { // Edit button
+            string new_date = get_text_input("New Date (YYYY-MM-DD) [" + format_date(t.date) + "]:", 200, 100, 400, 30);
+            if (!new_date.empty() && !parse_date(new_date, t.date)) {
+                clear_screen(COLOR_WHITE);
+                draw_text_centered("Invalid date. Not updated.", screen_height() / 2);
+                wait_for_mouse_click_to_return();
+            }
+
+            string new_category = get_text_input("New Category [" + user.categories.name(t.category) + "]:", 200, 150, 400, 30);
+            if (!new_category.empty()) t.category = user.categories.intern(new_category);
+
+            string new_description = get_text_input("New Description [" + t.description + "]:", 200, 200, 400, 30);
+            if (!new_description.empty()) t.description = new_description;
+
+            string new_amount_str = get_text_input("New Amount (number) [" + format_amount(t.amount) + "]:", 200, 250, 400, 30);
+            if (!new_amount_str.empty()) {
+                if (!parseMoney(new_amount_str, t.amount)) {
+                    clear_screen(COLOR_WHITE);
+                    draw_text_centered("Invalid amount. Not updated.", screen_height() / 2);
+                    wait_for_mouse_click_to_return();
+                }
+            }
+
+            string new_type_str = get_text_input("New Type (I/E) [" + string(1, t.type) + "]:", 200, 300, 400, 30);
+            if (!new_type_str.empty() && (toupper(new_type_str[0]) == 'I' || toupper(new_type_str[0]) == 'E')) {
+                t.type = toupper(new_type_str[0]);
+            } else if (!new_type_str.empty()) {
+                 clear_screen(COLOR_WHITE);
+                 draw_text_centered("Invalid type. Not updated.", screen_height() / 2);
+                 wait_for_mouse_click_to_return();
+            }
+
+            user.transactions.set(row, t);
+            journalEditTransaction(user, t);
+            user.dirty = true;
+            clear_screen(COLOR_WHITE);
+            draw_text_centered("Transaction updated!", screen_height() / 2);
+            wait_for_mouse_click_to_return();
+            return;
+        }
+        else if (is_button_clicked(start_x + btn_width + btn_spacing, 250, btn_width, btn_height)) { // Delete button
+            journalDeleteTransaction(user, t.id);
+            user.transactions.erase(row);
+            user.dirty = true;
+            clear_screen(COLOR_WHITE);
+            draw_text_centered("Transaction deleted!", screen_height() / 2);
+            wait_for_mouse_click_to_return();
+            return;
+        }
+        else if (is_button_clicked(start_x + 2 * (btn_width + btn_spacing), 250, btn_width, btn_height)) { // Cancel button
+            return;
+        }
+        delay(10);
+    }
+}
+
+
+/**
+ * Recompute every running total of a store from its rows. Returns a description of the
+ * first one that disagrees, or an empty string if all of them match.
+ */
+string findTotalsMismatch(const TransactionStore& transactions) {
+    Money dated_net;
+    map<int64_t, PeriodTotals> by_month;
+    const auto& live = transactions.live();
+    const auto& dates = transactions.dates();
+    const auto& categories = transactions.categories();
+    const auto& amounts = transactions.amounts();
+    const auto& types = transactions.types();
+
+    // Dead rows have no type, so the column sums skip them without reading live
+    const AggregationKernels& kernels = aggregationKernels();
+    TypeSums sums = kernels.sum_by_type(amounts.data(), types.data(), amounts.size());
+    Money income = sums.income, expense = sums.expense;
+    size_t category_count = categories.empty() ? 0 : *max_element(categories.begin(), categories.end()) + size_t(1);
+    vector<Money> by_category(category_count);
+    sumExpensesByCategory(amounts.data(), types.data(), categories.data(), categories.size(), by_category.data());
+
+    for (size_t i = 0; i < live.size(); i++) {
+        if (!live[i]) continue;
+        if (dates[i].valid()) {
+            if (types[i] == 'I') dated_net += amounts[i];
+            if (types[i] == 'E') dated_net -= amounts[i];
+            int64_t year;
+            unsigned month, day;
+            civilFromDays(dates[i].days, year, month, day);
+            PeriodTotals& totals = by_month[year * 12 + month - 1];
+            if (types[i] == 'I') totals.income += amounts[i];
+            else totals.expense += amounts[i];
+            totals.count++;
+        }
+    }
+
+    if (income != transactions.total_income()) return "income " + format_amount(transactions.total_income()) + ", rescan " + format_amount(income);
+    if (expense != transactions.total_expense()) return "expense " + format_amount(transactions.total_expense()) + ", rescan " + format_amount(expense);
+    for (CategoryId id = 0; id < by_category.size(); id++) {
+        if (by_category[id] != transactions.expense_total(id)) return "expenses for category " + to_string(id);
+    }
+    const PeriodRollup& months = transactions.monthly_totals();
+    size_t months_with_rows = 0;
+    for (int64_t month_index = months.first(); month_index < months.end(); month_index++) {
+        const PeriodTotals& totals = months[month_index];
+        if (totals.count == 0) continue;
+        months_with_rows++;
+        auto it = by_month.find(month_index);
+        if (it == by_month.end() || it->second.count != totals.count ||
+            it->second.income != totals.income || it->second.expense != totals.expense) {
+            return "monthly totals for month " + to_string(month_index);
+        }
+    }
+    if (months_with_rows != by_month.size()) return "monthly totals are missing months";
+    Money balance = transactions.balance_as_of(Date{Date::MAX_DAYS});
+    if (balance != dated_net) return "balance history " + format_amount(balance) + ", rescan " + format_amount(dated_net);
+    return "";
+}
+
+/**
+ * In --check-totals mode, rescan a user's transactions and report running totals that drifted
+ */
+void checkRunningTotals(const UserProfile& user) {
+    if (!g_check_totals) return;
+    string mismatch = findTotalsMismatch(user.transactions);
+    if (!mismatch.empty()) write_line("ERROR: Running totals for " + user.username + " disagree with a rescan: " + mismatch);
+}
+
+/**
+ * Display the running totals: total income, total expense, net amount
+ */
+void draw_summary(const TransactionStore& transactions) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Financial Summary ---", 20);
+
+    Money totalIncome = transactions.total_income(); // Kept up to date by every mutation
+    Money totalExpense = transactions.total_expense();
+
+    draw_text("Total Income: $" + format_amount(totalIncome), COLOR_GREEN, 50, 80);
+    draw_text("Total Expense: $" + format_amount(totalExpense), COLOR_RED, 50, 120);
+    draw_text("Net: $" + format_amount(totalIncome - totalExpense), COLOR_BLUE, 50, 160);
+
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * Display budget report comparing budgeted amount vs spent amount per category.
+ * Shows categories in red if spending exceeds budget and gives warnings.
+ */
+void drawBudgetReport(const UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Budget Report for " + user.username + " ---", 20);
+
+    int y = 80;
+    bool budget_exceeded_any_category = false;
+    for (const auto& [cat, budget] : user.budgetPerCategory) {
+        CategoryId id;
+        Money spent = user.categories.find(cat, id) ? user.transactions.expense_total(id) : Money(); // Running total, no rescan
+        string line = cat + ": Budget = $" + format_amount(budget) + ", Spent = $" + format_amount(spent);
+        color display_color = COLOR_BLACK;
+        if (spent > budget) {
+            display_color = COLOR_RED;
+            budget_exceeded_any_category = true;
+        } else if (budget.cents > 0 && spent.cents * 10 >= budget.cents * 9) { // Warn if close to budget (90% or more)
+             display_color = COLOR_ORANGE;
+        }
+        draw_text(line, display_color, 50, y);
+        y += 30;
+    }
+
+    if (budget_exceeded_any_category) {
+        draw_text_centered("WARNING: You have exceeded budget in one or more categories!", screen_height() - 80, COLOR_RED);
+    } else if (user.budgetPerCategory.empty()){
+        draw_text_centered("No budget categories set. Go to 'Set Budget' to add some!", screen_height() / 2, COLOR_GRAY);
+    }
+
+
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * UI to set/edit budget per category
+ */
+void set_budget_ui(UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Set Budget Per Category ---", 50);
+
+    // Display current budgets
+    int y_current_budgets = 100;
+    draw_text("Current Budgets:", COLOR_BLACK, 50, y_current_budgets);
+    y_current_budgets += 20;
+    if (user.budgetPerCategory.empty()) {
+        draw_text("No budgets set yet.", COLOR_GRAY, 70, y_current_budgets);
+        y_current_budgets += 20;
+    } else {
+        for (const auto& [cat, budget] : user.budgetPerCategory) {
+            draw_text(cat + ": $" + format_amount(budget), COLOR_BLACK, 70, y_current_budgets);
+            y_current_budgets += 20;
+        }
+    }
+
+
+    string category = get_text_input("Enter Category to set budget for (e.g., Food, Transport):", 200, y_current_budgets + 50, 400, 30);
+    if (category.empty()) return;
+
+    string amount_str = get_text_input("Enter Budget Amount for " + category + ":", 200, y_current_budgets + 100, 400, 30);
+    if (amount_str.empty()) return;
+
+    Money amount;
+    if (!parseMoney(amount_str, amount)) {
+        clear_screen(COLOR_WHITE);
+        draw_text_centered("Invalid amount. Please enter a valid number.", screen_height() / 2);
+        wait_for_mouse_click_to_return();
+        return;
+    }
+
+    user.budgetPerCategory[category] = amount;
+    journalSetBudget(user, category, amount);
+    user.dirty = true;
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("Budget for " + category + " set to $" + format_amount(amount) + "!", screen_height() / 2);
+    wait_for_mouse_click_to_return();
+}
+
+/**
+ * Display time-series report (monthly/yearly summary)
+ */
+void draw_time_series_report(const UserProfile& user) {
+    clear_screen(COLOR_WHITE);
+    draw_text_centered("--- Time Series Report ---", 20);
+
+    // Rollups are kept up to date by the store, so this is O(months) rather than O(transactions)
+    int y = 60;
+    draw_text("Monthly Summary:", COLOR_BLACK, 50, y);
+    y += 25;
+    const PeriodRollup& months = user.transactions.monthly_totals();
+    for (int64_t month_index = months.first(); month_index < months.end(); month_index++) {
+        const PeriodTotals& totals = months[month_index];
+        if (totals.count == 0) continue;
+        string month_year = format_date(Date{static_cast<int32_t>(daysFromCivil(month_index / 12, month_index % 12 + 1, 1))}).substr(0, 7);
+        draw_text(month_year + ": Income=$" + format_amount(totals.income) + ", Expense=$" + format_amount(totals.expense) + ", Net=$" + format_amount(totals.income - totals.expense), COLOR_BLACK, 70, y);
+        y += 20;
+    }
+
+    y += 30; // Spacer
+    draw_text("Yearly Summary:", COLOR_BLACK, 50, y);
+    y += 25;
+    for (int64_t month_index = months.first(); month_index < months.end(); ) {
+        int64_t year = month_index / 12;
+        PeriodTotals totals;
+        for (; month_index < months.end() && month_index / 12 == year; month_index++) {
+            totals.income += months[month_index].income;
+            totals.expense += months[month_index].expense;
+            totals.count += months[month_index].count;
+        }
+        if (totals.count == 0) continue;
+        draw_text(to_string(year) + ": Income=$" + format_amount(totals.income) + ", Expense=$" + format_amount(totals.expense) + ", Net=$" + format_amount(totals.income - totals.expense), COLOR_BLACK, 70, y);
+        y += 20;
+    }
+
+    wait_for_mouse_click_to_return();
+}
+
+
+// --- File Management ---
+
+// Storage is sharded per user: USER_INDEX_FILE lists every username and password, and each
+// user's transactions and budgets live in USER_DATA_DIR as a snapshot plus a journal of
+// mutations made since that snapshot. Only the logged-in user's shard is read.
+const string USER_INDEX_FILE = "users.idx";
+const string USER_DATA_DIR = "user_data";
+
+// Single-file layout used before sharding; migrated on first start
+const string USERS_FILE = "users.txt";       // Snapshot of all users
+const string JOURNAL_FILE = "users.journal"; // Mutations made since the last snapshot
+const string COMPACTING_JOURNAL_FILE = "users.journal.compacting"; // Journal being folded into a new snapshot
+
+/**
+ * Thresholds at which the journal is folded into a fresh snapshot in the background.
+ * Whichever limit is reached first triggers compaction.
+ */
+struct CompactionSettings {
+    size_t max_journal_records = 1000;
+    size_t max_journal_bytes = 1024 * 1024;
+};
+
+CompactionSettings g_compaction_settings;
+
+/**
+ * How journal records are made durable. Records arriving within the window are written
+ * together and synced to disk with a single fsync (group commit).
+ */
+struct GroupCommitSettings {
+    chrono::milliseconds window{5};
+};
+
+GroupCommitSettings g_group_commit_settings;
+
+/**
+ * Flush a file's (or directory's) contents to stable storage. Returns false on failure.
+ * Directories are synced after a rename so the new name itself survives a crash;
+ * Windows has no equivalent, so there this only syncs files.
+ */
+bool syncPath(const string& path, bool is_directory = false) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY | (is_directory ? O_DIRECTORY : 0));
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    if (is_directory) return true;
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) return false;
+    bool ok = _commit(fd) == 0;
+    _close(fd);
+    return ok;
+#endif
+}
+
+/**
+ * Directory containing a path, for syncing after a rename
+ */
+string parentDirectory(const string& path) {
+    string parent = filesystem::path(path).parent_path().string();
+    return parent.empty() ? "." : parent;
+}
+
+/**
+ * Rename `from` over `to` and make both the contents and the new name durable:
+ * the classic temp file, fsync, rename, fsync directory sequence.
+ */
+bool renameDurably(const string& from, const string& to) {
+    if (!syncPath(from)) return false;
+    error_code ec;
+    filesystem::rename(from, to, ec);
+    if (ec) return false;
+    return syncPath(parentDirectory(to), true);
+}
+
+/**
+ * Append-only file with an explicit sync, used for journals
+ */
+class AppendFile {
+public:
+    ~AppendFile() { close(); }
+
+    bool open(const string& path) {
+        close();
+        error_code ec;
+        bool created = !filesystem::exists(path, ec);
+#ifndef _WIN32
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#else
+        fd_ = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#endif
+        path_ = path;
+        if (fd_ >= 0 && created) syncPath(parentDirectory(path), true); // Make the new name durable
+        return fd_ >= 0;
+    }
+
+    bool append(const string& text) {
+        size_t written = 0;
+        while (fd_ >= 0 && written < text.size()) {
+#ifndef _WIN32
+            auto n = ::write(fd_, text.data() + written, text.size() - written);
+#else
+            auto n = _write(fd_, text.data() + written, static_cast<unsigned>(text.size() - written));
+#endif
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+            unsynced_ = true;
+        }
+        return fd_ >= 0;
+    }
+
+    // Returns true without touching the disk if nothing was appended since the last sync
+    bool sync() {
+        if (fd_ < 0) return false;
+        if (!unsynced_) return true;
+#ifndef _WIN32
+        bool ok = fsync(fd_) == 0;
+#else
+        bool ok = _commit(fd_) == 0;
+#endif
+        unsynced_ = !ok;
+        return ok;
+    }
+
+    void close() {
+        if (fd_ < 0) return;
+#ifndef _WIN32
+        ::close(fd_);
+#else
+        _close(fd_);
+#endif
+        fd_ = -1;
+        path_.clear();
+        unsynced_ = false;
+    }
+
+    bool is_open() const { return fd_ >= 0; }
+    const string& path() const { return path_; }
+
+private:
+    int fd_ = -1;
+    string path_;
+    bool unsynced_ = false;
+};
+
+AppendFile g_journal;   // Kept open between records; used only by the persistence thread
+
+/**
+ * Format transaction fields as "id|date|category|description|amount|type",
+ * the same layout used by TRANS lines in the snapshot
+ */
+string formatTransactionFields(const UserProfile& user, const Transaction& t) {
+    ostringstream oss;
+    oss << t.id << "|" << format_date(t.date) << "|" << user.categories.name(t.category) << "|" << t.description << "|" << format_amount(t.amount) << "|" << t.type;
+    return oss.str();
+}
+
+/**
+ * Insert or overwrite a transaction by ID.
+ * Replay uses this for both ADD and EDIT so that applying a record twice is harmless.
+ */
+void upsertTransaction(UserProfile& user, const Transaction& t) {
+    if (!user.transactions.update(t)) user.transactions.push_back(t);
+    user.next_transaction_id = max(user.next_transaction_id, t.id + 1);
+}
+
+/**
+ * Split a journal line into its '|' separated fields
+ */
+vector<string> splitJournalRecord(const string& line) {
+    stringstream ss(line);
+    string token;
+    vector<string> parts;
+    while (getline(ss, token, '|')) {
+        parts.push_back(token);
+    }
+    return parts;
+}
+
+/**
+ * Apply one ADD, EDIT, DELETE or BUDGET record to its user.
+ * Malformed records (e.g. a line cut short by a crash) are ignored.
+ */
+void applyJournalRecord(UserProfile& user, const vector<string>& parts) {
+    const string& kind = parts[0];
+    try {
+        if ((kind == "ADD" || kind == "EDIT") && parts.size() == 8) {
+            Money amount;
+            int id = stoi(parts[2]);
+            Date date;
+            parse_date(parts[3], date); // Unreadable dates in old records load as missing
+            if (parseMoney(parts[6], amount)) upsertTransaction(user, {date, user.categories.intern(parts[4]), parts[5], amount, parts[7][0], id});
+        } else if (kind == "DELETE" && parts.size() == 3) {
+            user.transactions.remove(stoi(parts[2]));
+        } else if (kind == "BUDGET" && parts.size() == 4) {
+            Money amount;
+            if (parseMoney(parts[3], amount)) user.budgetPerCategory[parts[2]] = amount;
+        }
+    } catch (...) {
+        // Unparseable number in a torn record
+    }
+}
+
+/**
+ * Apply every record in a single-file layout journal on top of the users loaded from
+ * its snapshot. Records name their user; REGISTER records create users.
+ */
+void replayJournal(UserRegistry& users, const string& path) {
+    ifstream ifs(path);
+    string line;
+    while (ifs.is_open() && getline(ifs, line)) {
+        vector<string> parts = splitJournalRecord(line);
+        if (parts.size() < 2) continue;
+
+        if (parts[0] == "REGISTER" && parts.size() == 3) {
+            users.add(UserProfile{parts[1], parts[2], {}, {}}); // No-op if already registered
+        } else if (UserProfile* user = users.find(parts[1])) {
+            applyJournalRecord(*user, parts);
+        }
+    }
+}
+
+/**
+ * Apply every record in one user's journal. Returns the number of lines read.
+ */
+size_t replayUserJournal(UserProfile& user, const string& path) {
+    ifstream ifs(path);
+    if (!ifs.is_open()) return 0;
+
+    size_t records = 0;
+    string line;
+    while (getline(ifs, line)) {
+        records++;
+        vector<string> parts = splitJournalRecord(line);
+        if (parts.size() >= 2 && parts[1] == user.username) applyJournalRecord(user, parts);
+    }
+    return records;
+}
+
+/**
+ * Write one user's block in the users.txt snapshot format
+ */
+void writeTextUserBlock(const UserProfile& user, ostream& os) {
+    os << "USER|" << user.username << "|" << user.password << "\n"; // Save username and password
+    os << "NEXT_ID|" << user.next_transaction_id << "\n"; // Save next transaction ID for continuity
+
+    os << "BUDGETS|";
+    for (const auto& [cat, val] : user.budgetPerCategory) {
+        os << cat << ":" << format_amount(val) << ",";
+    }
+    os << "\n";
+
+    for (const auto t : user.transactions) {
+        os << "TRANS|" << formatTransactionFields(user, t.value()) << "\n";
+    }
+    os << "ENDUSER\n";
+}
+
+/**
+ * Write all user profiles in the users.txt snapshot format
+ */
+void writeSnapshot(const vector<UserProfile>& users, ostream& os) {
+    for (const auto& user : users) {
+        writeTextUserBlock(user, os);
+    }
+}
+
+/**
+ * Reference parser for the users.txt text format built on getline and stringstream.
+ * Superseded by loadTextSnapshot; kept so --bench-load can time and cross-check it.
+ */
+bool loadTextSnapshotWithStreams(const string& path, vector<UserProfile>& users) {
+    ifstream ifs(path);
+    if (!ifs.is_open()) return false;
+
+    string line;
+    UserProfile* currentUser = nullptr;
+    while (getline(ifs, line)) {
+        if (line.rfind("USER|", 0) == 0) {
+            users.push_back(UserProfile());
+            currentUser = &users.back();
+            stringstream ss(line);
+            string token;
+            getline(ss, token, '|'); // Read "USER" token
+            getline(ss, currentUser->username, '|'); // Read username
+            getline(ss, currentUser->password, '|'); // Read password
+        } else if (line.rfind("NEXT_ID|", 0) == 0 && currentUser != nullptr) {
+            currentUser->next_transaction_id = stoi(line.substr(8));
+        }
+        else if (line.rfind("BUDGETS|", 0) == 0 && currentUser != nullptr) {
+            string budgets_str = line.substr(8);
+            stringstream ss(budgets_str);
+            string part;
+            while (getline(ss, part, ',')) {
+                if (part.empty()) continue;
+                auto pos = part.find(':');
+                if (pos != string::npos) {
+                    string cat = part.substr(0, pos);
+                    Money val;
+                    if (parseMoney(part.substr(pos + 1), val)) currentUser->budgetPerCategory[cat] = val;
+                }
+            }
+        } else if (line.rfind("TRANS|", 0) == 0 && currentUser != nullptr) {
+            stringstream ss(line);
+            string token;
+            vector<string> parts;
+            // Use a loop to split by '|'
+            while (getline(ss, token, '|')) {
+                parts.push_back(token);
+            }
+            if (parts.size() == 7) { // Expect 7 parts: "TRANS", id, date, category, desc, amount, type
+                int id = stoi(parts[1]);
+                Date date;
+                parse_date(parts[2], date);
+                string cat = parts[3];
+                string desc = parts[4];
+                Money amount;
+                char type = parts[6][0];
+                if (parseMoney(parts[5], amount)) currentUser->transactions.push_back({date, currentUser->categories.intern(cat), desc, amount, type, id});
+            }
+        } else if (line == "ENDUSER") {
+            currentUser = nullptr;
+        }
+    }
+    ifs.close();
+    return true;
+}
+
+// --- Binary Snapshot Format ---
+//
+// Layout (native byte order, every section padded to 8 bytes):
+//   BinaryFileHeader
+//   per user: BinaryUserHeader, then the columns
+//     categories   BinaryStringRef[category_count]   (dictionary for category ids)
+//     budgets      BinaryBudget[budget_count]
+//     ids          int32[transaction_count]
+//     dates        int32[transaction_count]             (days since 1970-01-01)
+//     category ids uint32[transaction_count]
+//     amounts      int64[transaction_count]             (cents)
+//     types        char[transaction_count]
+//     descriptions BinaryStringRef[transaction_count]
+//     heap         char[heap_bytes]                  (all strings of this user)
+// Because every column is fixed width, a mapped file is read in place with no per-row parsing.
+// Older versions are still read: version 1 held float amounts, rounded to the nearest cent
+// on load, and versions 1 and 2 held dates as strings in the heap.
+
+const char BINARY_SNAPSHOT_MAGIC[8] = {'B', 'K', 'S', 'N', 'A', 'P', '\r', '\n'};
+const uint32_t BINARY_SNAPSHOT_VERSION = 3;
+
+struct BinaryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t user_count;
+};
+
+struct BinaryStringRef {
+    uint32_t offset; // Into the user's string heap
+    uint32_t length;
+};
+
+struct BinaryBudget {
+    uint32_t category_id;
+    uint32_t reserved;
+    int64_t cents;
+};
+
+struct BinaryBudgetV1 {
+    uint32_t category_id;
+    float amount;
+};
+
+struct BinaryUserHeader {
+    uint64_t block_bytes; // Header, columns and heap, padded to 8 bytes
+    uint64_t transaction_count;
+    uint32_t category_count;
+    uint32_t budget_count;
+    uint32_t heap_bytes;
+    int32_t next_transaction_id;
+    BinaryStringRef username;
+    BinaryStringRef password;
+};
+
+static_assert(sizeof(BinaryFileHeader) == 16, "binary snapshot header layout changed");
+static_assert(sizeof(BinaryUserHeader) == 48, "binary user header layout changed");
+static_assert(sizeof(BinaryBudget) == 16, "binary budget layout changed");
+
+enum class SnapshotFormat { Text, Binary, Compressed };
+
+SnapshotFormat g_snapshot_format = SnapshotFormat::Text; // Format written by saves and compaction
+
+/**
+ * Byte offsets of each column within a user block, relative to the start of the block
+ */
+struct BinaryUserLayout {
+    uint64_t categories, budgets, ids, dates, category_ids, amounts, types, descriptions, heap, end;
+};
+
+uint64_t alignTo8(uint64_t n) {
+    return (n + 7) & ~uint64_t(7);
+}
+
+BinaryUserLayout computeBinaryUserLayout(const BinaryUserHeader& h, uint32_t version = BINARY_SNAPSHOT_VERSION) {
+    BinaryUserLayout l;
+    uint64_t n = h.transaction_count;
+    size_t budget_bytes = version == 1 ? sizeof(BinaryBudgetV1) : sizeof(BinaryBudget);
+    size_t amount_bytes = version == 1 ? sizeof(float) : sizeof(int64_t);
+    size_t date_bytes = version < 3 ? sizeof(BinaryStringRef) : sizeof(int32_t);
+    l.categories = sizeof(BinaryUserHeader);
+    l.budgets = alignTo8(l.categories + h.category_count * sizeof(BinaryStringRef));
+    l.ids = alignTo8(l.budgets + h.budget_count * budget_bytes);
+    l.dates = alignTo8(l.ids + n * sizeof(int32_t));
+    l.category_ids = alignTo8(l.dates + n * date_bytes);
+    l.amounts = alignTo8(l.category_ids + n * sizeof(uint32_t));
+    l.types = alignTo8(l.amounts + n * amount_bytes);
+    l.descriptions = alignTo8(l.types + n);
+    l.heap = alignTo8(l.descriptions + n * sizeof(BinaryStringRef));
+    l.end = alignTo8(l.heap + h.heap_bytes);
+    return l;
+}
+
+/**
+ * Write the file header of a binary snapshot holding `user_count` users
+ */
+void writeBinaryFileHeader(uint32_t user_count, ostream& os) {
+    BinaryFileHeader file_header{};
+    memcpy(file_header.magic, BINARY_SNAPSHOT_MAGIC, sizeof(file_header.magic));
+    file_header.version = BINARY_SNAPSHOT_VERSION;
+    file_header.user_count = user_count;
+    os.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+}
+
+/**
+ * The category dictionary a snapshot stores for `user`: their categories plus any budget
+ * categories with no transactions yet. budget_categories gets the id of each budget
+ * category, in budgetPerCategory order.
+ */
+CategoryDictionary snapshotCategories(const UserProfile& user, vector<uint32_t>& budget_categories) {
+    CategoryDictionary dictionary = user.categories;
+    budget_categories.clear();
+    for (const auto& [cat, val] : user.budgetPerCategory) budget_categories.push_back(dictionary.intern(cat));
+    return dictionary;
+}
+
+/**
+ * Write one user's block in the binary snapshot format
+ */
+void writeBinaryUserBlock(const UserProfile& user, ostream& os) {
+    string heap;
+    auto add_string = [&](const string& str) {
+        BinaryStringRef ref{static_cast<uint32_t>(heap.size()), static_cast<uint32_t>(str.size())};
+        heap += str;
+        return ref;
+    };
+
+    vector<uint32_t> budget_categories;
+    CategoryDictionary dictionary = snapshotCategories(user, budget_categories);
+
+    TransactionStore scratch;
+    const TransactionStore& ts = withoutDeadRows(user.transactions, scratch);
+    size_t n = ts.rows();
+    vector<BinaryBudget> budgets;
+    vector<int32_t> ids(n);
+    vector<int32_t> dates(n);
+    vector<uint32_t> cat_column(n);
+    vector<int64_t> amounts(n);
+    vector<char> types(n);
+    vector<BinaryStringRef> descriptions(n);
+
+    BinaryUserHeader header{};
+    header.username = add_string(user.username);
+    header.password = add_string(user.password);
+    vector<BinaryStringRef> categories;
+    for (const string& name : dictionary.names) categories.push_back(add_string(name));
+    size_t b = 0;
+    for (const auto& [cat, val] : user.budgetPerCategory) {
+        budgets.push_back({budget_categories[b++], 0, val.cents});
+    }
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = ts.ids()[i];
+        dates[i] = ts.dates()[i].days;
+        cat_column[i] = ts.categories()[i];
+        amounts[i] = ts.amounts()[i].cents;
+        types[i] = ts.types()[i];
+        string_view description = ts.description(i);
+        descriptions[i] = {static_cast<uint32_t>(heap.size()), static_cast<uint32_t>(description.size())};
+        heap.append(description.data(), description.size());
+    }
+
+    header.transaction_count = n;
+    header.category_count = static_cast<uint32_t>(categories.size());
+    header.budget_count = static_cast<uint32_t>(budgets.size());
+    header.heap_bytes = static_cast<uint32_t>(heap.size());
+    header.next_transaction_id = user.next_transaction_id;
+    BinaryUserLayout layout = computeBinaryUserLayout(header);
+    header.block_bytes = layout.end;
+
+    uint64_t written = 0;
+    auto write_section = [&](uint64_t offset, const void* data, size_t bytes) {
+        static const char padding[8] = {};
+        os.write(padding, static_cast<streamsize>(offset - written));
+        os.write(static_cast<const char*>(data), static_cast<streamsize>(bytes));
+        written = offset + bytes;
+    };
+    write_section(0, &header, sizeof(header));
+    write_section(layout.categories, categories.data(), categories.size() * sizeof(BinaryStringRef));
+    write_section(layout.budgets, budgets.data(), budgets.size() * sizeof(BinaryBudget));
+    write_section(layout.ids, ids.data(), n * sizeof(int32_t));
+    write_section(layout.dates, dates.data(), n * sizeof(int32_t));
+    write_section(layout.category_ids, cat_column.data(), n * sizeof(uint32_t));
+    write_section(layout.amounts, amounts.data(), n * sizeof(int64_t));
+    write_section(layout.types, types.data(), n);
+    write_section(layout.descriptions, descriptions.data(), n * sizeof(BinaryStringRef));
+    write_section(layout.heap, heap.data(), heap.size());
+    write_section(layout.end, nullptr, 0);
+}
+
+/**
+ * Write all user profiles in the binary snapshot format
+ */
+void writeBinarySnapshot(const vector<UserProfile>& users, ostream& os) {
+    writeBinaryFileHeader(static_cast<uint32_t>(users.size()), os);
+    for (const auto& user : users) {
+        writeBinaryUserBlock(user, os);
+    }
+}
+
+/**
+ * Read-only view of a whole file: memory-mapped where available,
+ * otherwise read into a buffer
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            open_ = st.st_size == 0; // Empty files cannot be mapped but are valid
+            if (st.st_size > 0) {
+                void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    data_ = static_cast<const char*>(mapped);
+                    size_ = static_cast<size_t>(st.st_size);
+                    mapped_ = true;
+                    open_ = true;
+                }
+            }
+        }
+        ::close(fd);
+#else
+        ifstream ifs(path, ios::binary);
+        if (!ifs.is_open()) return;
+        buffer_.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        open_ = true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const { return open_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    bool mapped_ = false;
+    vector<char> buffer_;
+};
+
+/**
+ * Split the next field off the front of `rest` at `delim`.
+ * Repeated calls while `rest` is non-empty yield the same fields as getline.
+ */
+string_view nextField(string_view& rest, char delim) {
+    size_t pos = rest.find(delim);
+    string_view field = rest.substr(0, pos);
+    rest = pos == string_view::npos ? string_view() : rest.substr(pos + 1);
+    return field;
+}
+
+bool startsWith(string_view text, string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+/**
+ * Parse a leading number from text like stoi/stof, without throwing or allocating
+ */
+template <typename T>
+bool parseNumber(string_view text, T& value) {
+    return from_chars(text.data(), text.data() + text.size(), value).ec == errc();
+}
+
+/**
+ * Parse one user block of the users.txt text format: a "USER|" line and everything up to
+ * the next one. Lines after ENDUSER are ignored. Lines with unparseable numbers are skipped.
+ */
+void parseTextUserBlock(string_view rest, UserProfile& user) {
+    // Size the transaction vector once from the number of lines in this block
+    user.transactions.reserve(static_cast<size_t>(count(rest.begin(), rest.end(), '\n')));
+
+    bool in_user = true;
+    while (!rest.empty() && in_user) {
+        string_view line = nextField(rest, '\n');
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        if (startsWith(line, "USER|")) {
+            string_view fields = line.substr(5);
+            user.username = nextField(fields, '|');
+            user.password = nextField(fields, '|');
+        } else if (startsWith(line, "NEXT_ID|")) {
+            parseNumber(line.substr(8), user.next_transaction_id);
+        } else if (startsWith(line, "BUDGETS|")) {
+            string_view budgets = line.substr(8);
+            while (!budgets.empty()) {
+                string_view part = nextField(budgets, ',');
+                auto pos = part.find(':');
+                Money val;
+                if (pos != string_view::npos && parseMoney(part.substr(pos + 1), val)) {
+                    user.budgetPerCategory[string(part.substr(0, pos))] = val;
+                }
+            }
+        } else if (startsWith(line, "TRANS|")) {
+            // Expect 7 parts: "TRANS", id, date, category, desc, amount, type
+            string_view parts[8];
+            size_t count = 0;
+            string_view fields = line;
+            while (!fields.empty() && count < 8) {
+                parts[count++] = nextField(fields, '|');
+            }
+            int id;
+            Money amount;
+            if (count == 7 && !parts[6].empty() && parseNumber(parts[1], id) && parseMoney(parts[5], amount)) {
+                Date date;
+                parse_date(parts[2], date); // Unreadable dates in old files load as missing
+                user.transactions.append(id, date, user.categories.intern(parts[3]), amount, parts[6][0], parts[4]);
+            }
+        } else if (line == "ENDUSER") {
+            in_user = false;
+        }
+    }
+}
+
+/**
+ * Find where each user block starts: every line beginning with "USER|".
+ * Anything before the first such line belongs to no user and is ignored.
+ */
+vector<size_t> findTextUserBlocks(string_view text) {
+    vector<size_t> starts;
+    if (startsWith(text, "USER|")) starts.push_back(0);
+    for (size_t pos = text.find("\nUSER|"); pos != string_view::npos; pos = text.find("\nUSER|", pos + 1)) {
+        starts.push_back(pos + 1);
+    }
+    return starts;
+}
+
+/**
+ * Read a snapshot in the users.txt text format. Returns false if the file cannot be opened.
+ * The file is mapped and split in place with string_view, so the only allocations are
+ * the strings stored in the resulting UserProfiles. User blocks are independent, so after
+ * locating their boundaries they are parsed on a pool of worker threads, each writing
+ * its own slot so users keep their file order.
+ */
+bool loadTextSnapshot(const string& path, vector<UserProfile>& users) {
+    MappedFile file(path);
+    if (!file.is_open()) return false;
+
+    string_view text(file.data(), file.size());
+    vector<size_t> starts = findTextUserBlocks(text);
+    size_t first = users.size();
+    users.resize(first + starts.size());
+
+    auto parse_block = [&](size_t b) {
+        size_t end = b + 1 < starts.size() ? starts[b + 1] : text.size();
+        parseTextUserBlock(text.substr(starts[b], end - starts[b]), users[first + b]);
+    };
+
+    size_t worker_count = min<size_t>(max(1u, thread::hardware_concurrency()), starts.size());
+    if (worker_count <= 1) {
+        for (size_t b = 0; b < starts.size(); b++) parse_block(b);
+        return true;
+    }
+
+    atomic<size_t> next_block{0};
+    vector<thread> workers;
+    for (size_t w = 0; w < worker_count; w++) {
+        workers.emplace_back([&] {
+            for (size_t b = next_block++; b < starts.size(); b = next_block++) parse_block(b);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    return true;
+}
+
+/**
+ * Check whether a file starts with the given 8-byte magic
+ */
+bool fileHasMagic(const string& path, const char (&expected)[8]) {
+    ifstream ifs(path, ios::binary);
+    char magic[8] = {};
+    ifs.read(magic, sizeof(magic));
+    return ifs.gcount() == sizeof(magic) && memcmp(magic, expected, sizeof(magic)) == 0;
+}
+
+/**
+ * Check whether a file starts with the binary snapshot magic
+ */
+bool isBinarySnapshotFile(const string& path) {
+    return fileHasMagic(path, BINARY_SNAPSHOT_MAGIC);
+}
+
+/**
+ * Read a binary snapshot by mapping it and copying the columns straight into UserProfiles.
+ * Every offset is bounds-checked; returns false if the file is missing, truncated or corrupt.
+ */
+bool loadBinarySnapshot(const string& path, vector<UserProfile>& users) {
+    MappedFile file(path);
+    const char* base = file.data();
+    size_t size = file.size();
+    if (base == nullptr || size < sizeof(BinaryFileHeader)) return false;
+
+    BinaryFileHeader file_header;
+    memcpy(&file_header, base, sizeof(file_header));
+    if (memcmp(file_header.magic, BINARY_SNAPSHOT_MAGIC, sizeof(file_header.magic)) != 0) return false;
+    uint32_t version = file_header.version;
+    if (version < 1 || version > BINARY_SNAPSHOT_VERSION) {
+        write_line("ERROR: Unsupported binary snapshot version " + to_string(version));
+        return false;
+    }
+
+    if (file_header.user_count > size / sizeof(BinaryUserHeader)) return false;
+
+    vector<UserProfile> loaded(file_header.user_count);
+    uint64_t pos = sizeof(BinaryFileHeader);
+    for (auto& user : loaded) {
+        if (size - pos < sizeof(BinaryUserHeader)) return false;
+        const char* block = base + pos;
+        BinaryUserHeader header;
+        memcpy(&header, block, sizeof(header));
+        if (header.transaction_count > size || header.category_count > size || header.budget_count > size) return false;
+        BinaryUserLayout layout = computeBinaryUserLayout(header, version);
+        if (header.block_bytes != layout.end || layout.end > size - pos) return false;
+
+        const char* heap = block + layout.heap;
+        auto valid = [&](const BinaryStringRef& ref) {
+            return ref.offset <= header.heap_bytes && ref.length <= header.heap_bytes - ref.offset;
+        };
+        auto to_string_ref = [&](const BinaryStringRef& ref) { return string(heap + ref.offset, ref.length); };
+
+        if (!valid(header.username) || !valid(header.password)) return false;
+        user.username = to_string_ref(header.username);
+        user.password = to_string_ref(header.password);
+        user.next_transaction_id = header.next_transaction_id;
+
+        const auto* categories = reinterpret_cast<const BinaryStringRef*>(block + layout.categories);
+        vector<CategoryId> category_ids(header.category_count);
+        for (uint32_t c = 0; c < header.category_count; c++) {
+            if (!valid(categories[c])) return false;
+            category_ids[c] = user.categories.intern(string_view(heap + categories[c].offset, categories[c].length));
+        }
+
+        for (uint32_t b = 0; b < header.budget_count; b++) {
+            uint32_t category_id;
+            Money amount;
+            if (version == 1) {
+                const auto& budget = reinterpret_cast<const BinaryBudgetV1*>(block + layout.budgets)[b];
+                category_id = budget.category_id;
+                amount = moneyFromFloat(budget.amount);
+            } else {
+                const auto& budget = reinterpret_cast<const BinaryBudget*>(block + layout.budgets)[b];
+                category_id = budget.category_id;
+                amount = Money{budget.cents};
+            }
+            if (category_id >= header.category_count) return false;
+            user.budgetPerCategory[user.categories.name(category_ids[category_id])] = amount;
+        }
+
+        size_t n = header.transaction_count;
+        const auto* ids = reinterpret_cast<const int32_t*>(block + layout.ids);
+        const auto* dates = reinterpret_cast<const int32_t*>(block + layout.dates);
+        const auto* date_strings = reinterpret_cast<const BinaryStringRef*>(block + layout.dates);
+        const auto* cat_column = reinterpret_cast<const uint32_t*>(block + layout.category_ids);
+        const auto* amounts = reinterpret_cast<const int64_t*>(block + layout.amounts);
+        const auto* float_amounts = reinterpret_cast<const float*>(block + layout.amounts);
+        const char* types = block + layout.types;
+        const auto* descriptions = reinterpret_cast<const BinaryStringRef*>(block + layout.descriptions);
+
+        user.transactions.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            if (!valid(descriptions[i]) || cat_column[i] >= header.category_count) return false;
+            Date date;
+            if (version < 3) {
+                if (!valid(date_strings[i])) return false;
+                parse_date(string_view(heap + date_strings[i].offset, date_strings[i].length), date);
+            } else {
+                if (dates[i] != Date::NONE && (dates[i] < Date::MIN_DAYS || dates[i] > Date::MAX_DAYS)) return false;
+                date.days = dates[i];
+            }
+            Money amount = version == 1 ? moneyFromFloat(float_amounts[i]) : Money{amounts[i]};
+            user.transactions.append(ids[i], date, category_ids[cat_column[i]], amount, types[i],
+                                     string_view(heap + descriptions[i].offset, descriptions[i].length));
+        }
+        pos += layout.end;
+    }
+
+    users = move(loaded);
+    return true;
+}
+
+// --- Compressed Snapshot Format ---
+//
+// Layout: BinaryFileHeader with COMPRESSED_SNAPSHOT_MAGIC, then per user a u32 raw size,
+// a u32 compressed size and the user's block compressed with compressBlock. Uncompressed,
+// a block is a sequence of varints and length-prefixed strings:
+//   username, password, next id, category dictionary, budgets (category id, amount),
+//   transaction count, then one column at a time: ids (delta), dates (delta in days, 0 if missing),
+//   category ids, amounts (zigzag cents), types, descriptions.
+// Columns of similar values compress far better than interleaved rows. Older versions are
+// still read: version 1 held float amounts with a raw escape, rounded to the nearest cent
+// on load, and versions 1 and 2 followed a 0 date tag with the date as a string.
+
+const char COMPRESSED_SNAPSHOT_MAGIC[8] = {'B', 'K', 'C', 'O', 'M', 'P', '\r', '\n'};
+const uint32_t COMPRESSED_SNAPSHOT_VERSION = 3;
+
+void putVarint(string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+uint64_t zigzagEncode(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t zigzagDecode(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+void putString(string& out, const string& str) {
+    putVarint(out, str.size());
+    out += str;
 }
 
 /**
- * Calculate total expense amount grouped by category from transaction list
+ * Bounds-checked reader over an uncompressed block. Every read fails cleanly past the end.
  */
-map<string, float> calculateExpensesByCategory(const vector<Transaction>& transactions) {
-    map<string, float> expenses;
-    for (const auto& t : transactions) {
-        if (t.type == 'E') expenses[t.category] += t.amount;
+struct ByteReader {
+    const char* p;
+    const char* end;
+
+    bool varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(*p++);
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80) return true;
+        }
+        return false;
     }
-    return expenses;
-}
 
-/**
- * Wait for a mouse left button click to continue
- * Shows a prompt and then blocks until user clicks anywhere on screen
- */
-void wait_for_mouse_click_to_return() {
-    draw_text_centered("Click anywhere to return", screen_height() - 50);
-    refresh_screen();
+    bool bytes(size_t n, string_view& out) {
+        if (static_cast<size_t>(end - p) < n) return false;
+        out = string_view(p, n);
+        p += n;
+        return true;
+    }
 
-    while (!quit_requested()) {
-        process_events();
-        if (mouse_clicked(LEFT_BUTTON)) return;
-        delay(10); // Prevent busy-waiting
+    bool str(string& out) {
+        uint64_t n;
+        string_view bytes_view;
+        if (!varint(n) || !bytes(static_cast<size_t>(min<uint64_t>(n, SIZE_MAX)), bytes_view)) return false;
+        out.assign(bytes_view.data(), bytes_view.size());
+        return true;
     }
+};
+
+void putAmount(string& out, Money amount) {
+    putVarint(out, zigzagEncode(amount.cents));
 }
 
 /**
- * Parse YYYY-MM-DD date string into year, month, day integers
+ * Read an amount. Version 1 stored zigzag cents shifted left by one, or 1 followed by
+ * the raw float bytes when the float was not a whole number of cents.
  */
-bool parse_date(const string& date_str, int& year, int& month, int& day) {
-    stringstream ss(date_str);
-    char dash;
-    if (ss >> year >> dash && dash == '-' && ss >> month >> dash && dash == '-' && ss >> day) {
+bool getAmount(ByteReader& in, uint32_t version, Money& amount) {
+    uint64_t v;
+    if (!in.varint(v)) return false;
+    if (version != 1) {
+        amount = Money{zigzagDecode(v)};
         return true;
     }
-    return false;
+    if ((v & 1) == 0) {
+        amount = Money{zigzagDecode(v >> 1)};
+        return true;
+    }
+    string_view raw;
+    float value;
+    if (!in.bytes(sizeof(float), raw)) return false;
+    memcpy(&value, raw.data(), sizeof(float));
+    amount = moneyFromFloat(value);
+    return true;
 }
 
-// --- UI Interaction Functions ---
-
 /**
- * Draw a clickable button
+ * LZ77 block compressor in the style of LZ4: a sequence of (literals, match) pairs found
+ * with a hash of the next four bytes. Each sequence starts with a token whose high nibble
+ * is the literal count and low nibble the match length minus 4, both extended with 255-run
+ * bytes; then the literals, a 2-byte match offset and any length extension. The final
+ * sequence holds only literals.
  */
-void draw_button(const string& text, float x, float y, float width, float height, color btn_clr, color txt_clr) {
-    fill_rectangle(btn_clr, x, y, width, height);
-    draw_rectangle(COLOR_BLACK, x, y, width, height); // Border
-    draw_text(text, txt_clr, x + (width - text_width(text, "default_font", 16)) / 2, y + (height - text_height("Tg", "default_font", 16)) / 2);
+string compressBlock(const string& input) {
+    const size_t MIN_MATCH = 4;
+    const size_t HASH_BITS = 16;
+    const char* src = input.data();
+    size_t n = input.size();
+    vector<uint32_t> table(size_t(1) << HASH_BITS, UINT32_MAX);
+
+    string out;
+    out.reserve(n / 2 + 16);
+    auto put_length = [&](size_t len) {
+        for (; len >= 255; len -= 255) out += static_cast<char>(255);
+        out += static_cast<char>(len);
+    };
+    auto read32 = [&](size_t pos) {
+        uint32_t v;
+        memcpy(&v, src + pos, sizeof(v));
+        return v;
+    };
+    auto emit = [&](size_t anchor, size_t literals, size_t offset, size_t match_len) {
+        size_t match_code = match_len >= MIN_MATCH ? match_len - MIN_MATCH : 0;
+        out += static_cast<char>((min<size_t>(literals, 15) << 4) | min<size_t>(match_code, 15));
+        if (literals >= 15) put_length(literals - 15);
+        out.append(src + anchor, literals);
+        if (match_len == 0) return; // Final, literals-only sequence
+        out += static_cast<char>(offset & 0xFF);
+        out += static_cast<char>(offset >> 8);
+        if (match_code >= 15) put_length(match_code - 15);
+    };
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (n >= MIN_MATCH && i + MIN_MATCH <= n) {
+        uint32_t seq = read32(i);
+        uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+        uint32_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(i);
+        if (candidate != UINT32_MAX && i - candidate <= 0xFFFF && read32(candidate) == seq) {
+            size_t len = MIN_MATCH;
+            while (i + len < n && src[candidate + len] == src[i + len]) len++;
+            emit(anchor, i - anchor, i - candidate, len);
+            i += len;
+            anchor = i;
+        } else {
+            i++;
+        }
+    }
+    emit(anchor, n - anchor, 0, 0);
+    return out;
 }
 
 /**
- * Check if a button is clicked
+ * Inverse of compressBlock. Returns false if the data is corrupt or does not expand to
+ * exactly `raw_size` bytes.
  */
-bool is_button_clicked(float x, float y, float width, float height) {
-    return mouse_clicked(LEFT_BUTTON) && point_in_rectangle(mouse_position(), rectangle_from(x, y, width, height));
+bool decompressBlock(const char* src, size_t src_size, size_t raw_size, string& out) {
+    out.resize(raw_size);
+    char* dst = &out[0];
+    size_t ip = 0, op = 0;
+    auto get_length = [&](size_t& len) {
+        uint8_t byte;
+        do {
+            if (ip >= src_size) return false;
+            byte = static_cast<uint8_t>(src[ip++]);
+            len += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < src_size) {
+        uint8_t token = static_cast<uint8_t>(src[ip++]);
+        size_t literals = token >> 4;
+        if (literals == 15 && !get_length(literals)) return false;
+        if (literals > src_size - ip || literals > raw_size - op) return false;
+        memcpy(dst + op, src + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == src_size) break; // Final sequence
+
+        if (src_size - ip < 2) return false;
+        size_t offset = static_cast<uint8_t>(src[ip]) | (static_cast<size_t>(static_cast<uint8_t>(src[ip + 1])) << 8);
+        ip += 2;
+        size_t match_len = token & 0xF;
+        if (match_len == 15 && !get_length(match_len)) return false;
+        match_len += 4;
+        if (offset == 0 || offset > op || match_len > raw_size - op) return false;
+        for (size_t k = 0; k < match_len; k++, op++) dst[op] = dst[op - offset]; // May overlap
+    }
+    return op == raw_size;
 }
 
 /**
- * Get text input from user via SplashKit window.
- * Returns empty string if user cancels (e.g., presses ESC).
- * This function clears the screen for input and draws its own prompt.
+ * Encode one user's block (uncompressed) as described above
  */
-string get_text_input(const string& prompt, float x_input, float y_input, float width, float height) {
-    string input = "";
-    bool done = false;
-
-    // Clear screen once at the beginning of this input session
-    clear_screen(COLOR_WHITE);
-
-    // Draw static prompt and instructions
-    draw_text_centered(prompt, y_input - 50);
-    draw_text("Press ENTER to confirm, ESC to cancel", COLOR_GRAY, x_input, y_input + height + 10);
+string encodeCompressedUserBlock(const UserProfile& user) {
+    string out;
+    putString(out, user.username);
+    putString(out, user.password);
+    putVarint(out, zigzagEncode(user.next_transaction_id));
 
-    while (!quit_requested() && !done) {
-        process_events();
+    vector<uint32_t> budget_categories;
+    CategoryDictionary dictionary = snapshotCategories(user, budget_categories);
 
-        // Clear the input box area before redrawing to prevent residue
-        // This ensures the blinking cursor and input text are drawn cleanly each frame
-        fill_rectangle(COLOR_WHITE, x_input - 5, y_input - 5, width + 10, height + 10);
-        draw_rectangle(COLOR_BLACK, x_input - 5, y_input - 5, width + 10, height + 10); // Input box border
+    putVarint(out, dictionary.size());
+    for (const string& cat : dictionary.names) putString(out, cat);
+    putVarint(out, user.budgetPerCategory.size());
+    size_t b = 0;
+    for (const auto& [cat, val] : user.budgetPerCategory) {
+        putVarint(out, budget_categories[b++]);
+        putAmount(out, val);
+    }
 
-        // Draw input text with blinking cursor
-        if (static_cast<int>(current_ticks() / 500) % 2 == 0) {
-            draw_text(input + "|", COLOR_BLACK, x_input, y_input);
+    TransactionStore scratch;
+    const TransactionStore& ts = withoutDeadRows(user.transactions, scratch);
+    putVarint(out, ts.rows());
+    int64_t prev_id = 0;
+    for (int id : ts.ids()) {
+        putVarint(out, zigzagEncode(id - prev_id));
+        prev_id = id;
+    }
+    // Dates: 0 if missing, or 1 + zigzag of the day delta from the previous date
+    int64_t prev_day = 0;
+    for (Date date : ts.dates()) {
+        if (date.valid()) {
+            putVarint(out, 1 + zigzagEncode(date.days - prev_day));
+            prev_day = date.days;
         } else {
-            draw_text(input, COLOR_BLACK, x_input, y_input);
+            putVarint(out, 0);
         }
-        
-        refresh_screen();
+    }
+    for (CategoryId cat : ts.categories()) putVarint(out, cat);
+    for (Money amount : ts.amounts()) putAmount(out, amount);
+    out.append(ts.types().data(), ts.types().size());
+    for (size_t i = 0; i < ts.rows(); i++) {
+        string_view description = ts.description(i);
+        putVarint(out, description.size());
+        out.append(description.data(), description.size());
+    }
+    return out;
+}
 
-        if (key_typed(RETURN_KEY)) {
-            done = true;
-        } else if (key_typed(ESCAPE_KEY)) {
-            return ""; // Cancelled
-        } else if (key_typed(BACKSPACE_KEY)) {
-            if (!input.empty()) {
-                input.pop_back();
+/**
+ * Decode one user's block. Returns false if it is truncated or inconsistent.
+ */
+bool decodeCompressedUserBlock(const string& raw, uint32_t version, UserProfile& user) {
+    ByteReader in{raw.data(), raw.data() + raw.size()};
+    uint64_t v;
+    if (!in.str(user.username) || !in.str(user.password) || !in.varint(v)) return false;
+    user.next_transaction_id = static_cast<int>(zigzagDecode(v));
+
+    uint64_t category_count;
+    if (!in.varint(category_count) || category_count > raw.size()) return false;
+    vector<CategoryId> category_ids(category_count);
+    string name;
+    for (auto& id : category_ids) {
+        if (!in.str(name)) return false;
+        id = user.categories.intern(name);
+    }
+    uint64_t budget_count;
+    if (!in.varint(budget_count) || budget_count > raw.size()) return false;
+    for (uint64_t b = 0; b < budget_count; b++) {
+        Money amount;
+        if (!in.varint(v) || v >= category_count || !getAmount(in, version, amount)) return false;
+        user.budgetPerCategory[user.categories.name(category_ids[v])] = amount;
+    }
+
+    uint64_t n;
+    if (!in.varint(n) || n > raw.size()) return false;
+    vector<int> ids(n);
+    int64_t id = 0;
+    for (int& row_id : ids) {
+        if (!in.varint(v)) return false;
+        id += zigzagDecode(v);
+        row_id = static_cast<int>(id);
+    }
+    vector<Date> dates(n);
+    int64_t day = 0;
+    string date_string;
+    for (Date& date : dates) {
+        if (!in.varint(v)) return false;
+        if (v == 0) {
+            if (version < 3) {
+                if (!in.str(date_string)) return false;
+                parse_date(date_string, date);
             }
         } else {
-            // Check all possible key codes for printable characters
-            for (int k = 32; k <= 126; ++k) { // ASCII printable range
-                if (key_typed(static_cast<key_code>(k))) {
-                    char key_char = static_cast<char>(k);
-                    input += key_char;
-                }
-            }
+            day += zigzagDecode(v - 1);
+            if (day < Date::MIN_DAYS || day > Date::MAX_DAYS) return false;
+            date.days = static_cast<int32_t>(day);
         }
-        delay(10);
     }
-    return input;
+    vector<CategoryId> cat_column(n);
+    for (CategoryId& cat : cat_column) {
+        if (!in.varint(v) || v >= category_count) return false;
+        cat = category_ids[v];
+    }
+    vector<Money> amounts(n);
+    for (Money& amount : amounts) {
+        if (!getAmount(in, version, amount)) return false;
+    }
+    string_view types;
+    if (!in.bytes(n, types)) return false;
+    user.transactions.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        string_view description;
+        if (!in.varint(v) || !in.bytes(static_cast<size_t>(min<uint64_t>(v, SIZE_MAX)), description)) return false;
+        user.transactions.append(ids[i], dates[i], cat_column[i], amounts[i], types[i], description);
+    }
+    return in.p == in.end;
 }
 
-
-// --- Transaction Management ---
-
 /**
- * Add a new transaction via UI input
+ * Write one user's block in the compressed snapshot format
  */
-void add_transaction_ui(UserProfile& user) {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Add New Transaction ---", 50);
-
-    string date = get_text_input("Enter Date (YYYY-MM-DD):", 200, 100, 400, 30);
-    if (date.empty()) return;
+void writeCompressedUserBlock(const UserProfile& user, ostream& os) {
+    string raw = encodeCompressedUserBlock(user);
+    string packed = compressBlock(raw);
+    uint32_t sizes[2] = {static_cast<uint32_t>(raw.size()), static_cast<uint32_t>(packed.size())};
+    os.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    os.write(packed.data(), static_cast<streamsize>(packed.size()));
+}
 
-    string category = get_text_input("Enter Category:", 200, 150, 400, 30);
-    if (category.empty()) return;
+void writeCompressedFileHeader(uint32_t user_count, ostream& os) {
+    BinaryFileHeader file_header{};
+    memcpy(file_header.magic, COMPRESSED_SNAPSHOT_MAGIC, sizeof(file_header.magic));
+    file_header.version = COMPRESSED_SNAPSHOT_VERSION;
+    file_header.user_count = user_count;
+    os.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+}
 
-    string description = get_text_input("Enter Description:", 200, 200, 400, 30);
-    if (description.empty()) return;
+/**
+ * Write all user profiles in the compressed snapshot format
+ */
+void writeCompressedSnapshot(const vector<UserProfile>& users, ostream& os) {
+    writeCompressedFileHeader(static_cast<uint32_t>(users.size()), os);
+    for (const auto& user : users) {
+        writeCompressedUserBlock(user, os);
+    }
+}
 
-    string amount_str = get_text_input("Enter Amount (number):", 200, 250, 400, 30);
-    if (amount_str.empty()) return;
+/**
+ * Read a compressed snapshot. Returns false if the file is missing, truncated or corrupt.
+ */
+bool loadCompressedSnapshot(const string& path, vector<UserProfile>& users) {
+    MappedFile file(path);
+    const char* base = file.data();
+    size_t size = file.size();
+    if (base == nullptr || size < sizeof(BinaryFileHeader)) return false;
 
-    float amount;
-    try {
-        amount = stof(amount_str);
-    } catch (...) {
-        clear_screen(COLOR_WHITE); // Clear before showing error
-        draw_text_centered("Invalid amount. Please enter a valid number.", screen_height() / 2);
-        wait_for_mouse_click_to_return();
-        return;
+    BinaryFileHeader file_header;
+    memcpy(&file_header, base, sizeof(file_header));
+    if (memcmp(file_header.magic, COMPRESSED_SNAPSHOT_MAGIC, sizeof(file_header.magic)) != 0) return false;
+    if (file_header.version < 1 || file_header.version > COMPRESSED_SNAPSHOT_VERSION) {
+        write_line("ERROR: Unsupported compressed snapshot version " + to_string(file_header.version));
+        return false;
     }
+    if (file_header.user_count > size / (2 * sizeof(uint32_t))) return false;
 
-    string type_str = get_text_input("Enter Type (I for Income, E for Expense):", 200, 300, 400, 30);
-    if (type_str.empty() || (toupper(type_str[0]) != 'I' && toupper(type_str[0]) != 'E')) {
-        clear_screen(COLOR_WHITE); // Clear before showing error
-        draw_text_centered("Invalid type. Must be 'I' or 'E'.", screen_height() / 2);
-        wait_for_mouse_click_to_return();
-        return;
+    vector<UserProfile> loaded(file_header.user_count);
+    size_t pos = sizeof(BinaryFileHeader);
+    string raw;
+    for (auto& user : loaded) {
+        uint32_t sizes[2];
+        if (size - pos < sizeof(sizes)) return false;
+        memcpy(sizes, base + pos, sizeof(sizes));
+        pos += sizeof(sizes);
+        if (sizes[1] > size - pos) return false;
+        if (!decompressBlock(base + pos, sizes[1], sizes[0], raw) || !decodeCompressedUserBlock(raw, file_header.version, user)) return false;
+        pos += sizes[1];
     }
-    char type = toupper(type_str[0]);
 
-    user.transactions.push_back({date, category, description, amount, type, user.next_transaction_id++});
-    clear_screen(COLOR_WHITE); // Clear before showing success
-    draw_text_centered("Transaction added successfully!", screen_height() / 2);
-    wait_for_mouse_click_to_return();
+    users = move(loaded);
+    return true;
 }
 
 /**
- * Display all transactions on screen.
- * If categoryFilter is provided (non-empty), only show transactions of that category.
+ * Read a snapshot in any format, detected from the file's first bytes
  */
-void draw_transactions(const vector<Transaction>& transactions, const string& categoryFilter = "") {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Transactions ---", 20);
-
-    int y = 60;
-    // Display header
-    draw_text("ID | Date       | Category  | Description                | Type   | Amount", COLOR_BLACK, 20, y);
-    y += 25;
-    draw_line(COLOR_BLACK, 15, y, screen_width() - 15, y);
-    y += 10;
-
-    for (const auto& t : transactions) {
-        if (!categoryFilter.empty() && t.category != categoryFilter) continue;
-
-        string line = to_string(t.id) + " | " + t.date + " | " + t.category + " | " + t.description.substr(0, 25) + (t.description.length() > 25 ? "..." : "") + " | " + (t.type == 'I' ? "Income" : "Expense") + " | $" + format_amount(t.amount);
-        draw_text(line, COLOR_BLACK, 20, y);
-        y += 25;
-        if (y > screen_height() - 80) { // Leave space for "Click to return"
-            draw_text_centered("... (More transactions below) ...", y);
-            break;
-        }
+bool loadSnapshotFile(const string& path, vector<UserProfile>& users) {
+    if (isBinarySnapshotFile(path)) {
+        if (loadBinarySnapshot(path, users)) return true;
+        write_line("ERROR: " + path + " is not a valid binary snapshot.");
+        return false;
     }
-
-    wait_for_mouse_click_to_return();
+    if (fileHasMagic(path, COMPRESSED_SNAPSHOT_MAGIC)) {
+        if (loadCompressedSnapshot(path, users)) return true;
+        write_line("ERROR: " + path + " is not a valid compressed snapshot.");
+        return false;
+    }
+    return loadTextSnapshot(path, users);
 }
 
 /**
- * Edit or Delete a transaction
+ * Write a snapshot to an arbitrary path in the given format. Returns false on failure.
  */
-void edit_delete_transaction_ui(UserProfile& user) {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Edit/Delete Transaction ---", 50);
-
-    // Show transactions to help user choose
-    draw_transactions(user.transactions); 
-
-    // Re-draw the header for edit/delete screen after view
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Edit/Delete Transaction ---", 50);
-
-    string id_str = get_text_input("Enter ID of transaction to edit/delete:", 200, 100, 400, 30);
-    if (id_str.empty()) return;
+bool writeSnapshotFile(const vector<UserProfile>& users, const string& path, SnapshotFormat format) {
+    ofstream ofs(path, ios::binary | ios::trunc);
+    if (!ofs.is_open()) return false;
+    if (format == SnapshotFormat::Binary) writeBinarySnapshot(users, ofs);
+    else if (format == SnapshotFormat::Compressed) writeCompressedSnapshot(users, ofs);
+    else writeSnapshot(users, ofs);
+    ofs.close();
+    return !ofs.fail();
+}
 
-    int id_to_find;
-    try {
-        id_to_find = stoi(id_str);
-    } catch (...) {
-        clear_screen(COLOR_WHITE);
-        draw_text_centered("Invalid ID.", screen_height() / 2);
-        wait_for_mouse_click_to_return();
-        return;
+/**
+ * Write a single user to a one-user snapshot file in the given format. Returns false on failure.
+ */
+bool writeUserSnapshotFile(const UserProfile& user, const string& path, SnapshotFormat format) {
+    ofstream ofs(path, ios::binary | ios::trunc);
+    if (!ofs.is_open()) return false;
+    if (format == SnapshotFormat::Binary) {
+        writeBinaryFileHeader(1, ofs);
+        writeBinaryUserBlock(user, ofs);
+    } else if (format == SnapshotFormat::Compressed) {
+        writeCompressedFileHeader(1, ofs);
+        writeCompressedUserBlock(user, ofs);
+    } else {
+        writeTextUserBlock(user, ofs);
     }
+    ofs.close();
+    return !ofs.fail();
+}
 
-    auto it = find_if(user.transactions.begin(), user.transactions.end(), [&](const Transaction& t) {
-        return t.id == id_to_find;
-    });
+// --- Per-User Storage ---
 
-    if (it == user.transactions.end()) {
-        clear_screen(COLOR_WHITE);
-        draw_text_centered("Transaction with ID " + id_str + " not found.", screen_height() / 2);
-        wait_for_mouse_click_to_return();
-        return;
+/**
+ * Path of one of a user's files in USER_DATA_DIR. Characters other than lowercase letters,
+ * digits, '-' and '_' are written as %XX so any username maps to a distinct, portable
+ * file name, even on case-insensitive file systems.
+ */
+string userDataPath(const string& username, const string& extension) {
+    static const char hex[] = "0123456789ABCDEF";
+    string name;
+    for (unsigned char c : username) {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_') {
+            name += static_cast<char>(c);
+        } else {
+            name += '%';
+            name += hex[c >> 4];
+            name += hex[c & 0xF];
+        }
     }
+    return USER_DATA_DIR + "/" + name + extension;
+}
 
-    // Found transaction, now give options
-    Transaction& t = *it;
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("Transaction found:", 50);
-    draw_text("ID: " + to_string(t.id), COLOR_BLACK, 50, 100);
-    draw_text("Date: " + t.date, COLOR_BLACK, 50, 120);
-    draw_text("Category: " + t.category, COLOR_BLACK, 50, 140);
-    draw_text("Description: " + t.description, COLOR_BLACK, 50, 160);
-    draw_text("Amount: $" + format_amount(t.amount), COLOR_BLACK, 50, 180);
-    draw_text("Type: " + std::string(t.type == 'I' ? "Income" : "Expense"), COLOR_BLACK, 50, 200);
-
-    float btn_width = 100;
-    float btn_height = 40;
-    float btn_spacing = 20;
-    float start_x = (screen_width() - (btn_width * 3 + btn_spacing * 2)) / 2; // Center the group of buttons
-
-    draw_button("Edit", start_x, 250, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
-    draw_button("Delete", start_x + btn_width + btn_spacing, 250, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
-    draw_button("Cancel", start_x + 2 * (btn_width + btn_spacing), 250, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
-    refresh_screen();
+string userSnapshotPath(const string& username) { return userDataPath(username, ".dat"); }
+string userJournalPath(const string& username) { return userDataPath(username, ".journal"); }
+string userCompactingJournalPath(const string& username) { return userDataPath(username, ".journal.compacting"); }
 
-    while (!quit_requested()) {
-        process_events();
-        if (is_button_clicked(start_x, 250, btn_width, btn_height)) { // Edit button
-            string new_date = get_text_input("New Date (YYYY-MM-DD) [" + t.date + "]:", 200, 100, 400, 30);
-            if (!new_date.empty()) t.date = new_date;
+/**
+ * Durability measurements for journal records, reported on exit and by --bench-commit.
+ * Latency runs from the UI queueing a record to the fsync that made it durable.
+ */
+struct DurabilityStats {
+    size_t records = 0;          // Journal records made durable
+    size_t commits = 0;          // fsync calls that made them durable
+    double total_latency_ms = 0;
+    double max_latency_ms = 0;
+    chrono::steady_clock::time_point first_queued{};
+    chrono::steady_clock::time_point last_committed{};
+};
 
-            string new_category = get_text_input("New Category [" + t.category + "]:", 200, 150, 400, 30);
-            if (!new_category.empty()) t.category = new_category;
+DurabilityStats g_durability_stats; // Updated by the persistence thread under g_persistence_mutex
 
-            string new_description = get_text_input("New Description [" + t.description + "]:", 200, 200, 400, 30);
-            if (!new_description.empty()) t.description = new_description;
+/**
+ * Summarise durability latency and throughput
+ */
+string formatDurabilityStats(const DurabilityStats& stats) {
+    if (stats.records == 0) return "No journal records committed.";
+    double elapsed_s = chrono::duration<double>(stats.last_committed - stats.first_queued).count();
+    ostringstream oss;
+    oss << fixed << setprecision(2) << stats.records << " records in " << stats.commits << " commits ("
+        << static_cast<double>(stats.records) / max<size_t>(stats.commits, 1) << " per fsync), latency avg "
+        << stats.total_latency_ms / stats.records << " ms, max " << stats.max_latency_ms << " ms, throughput "
+        << (elapsed_s > 0 ? stats.records / elapsed_s : 0.0) << " records/s";
+    return oss.str();
+}
 
-            string new_amount_str = get_text_input("New Amount (number) [" + format_amount(t.amount) + "]:", 200, 250, 400, 30);
-            if (!new_amount_str.empty()) {
-                try {
-                    t.amount = stof(new_amount_str);
-                } catch (...) {
-                    clear_screen(COLOR_WHITE);
-                    draw_text_centered("Invalid amount. Not updated.", screen_height() / 2);
-                    wait_for_mouse_click_to_return();
-                }
-            }
+/**
+ * Sync the open journal to disk. Returns false if the sync failed.
+ * Runs on the persistence thread.
+ */
+bool commitJournal() {
+    if (!g_journal.is_open()) return true;
+    if (g_journal.sync()) return true;
+    write_line("ERROR: Could not sync " + g_journal.path());
+    return false;
+}
 
-            string new_type_str = get_text_input("New Type (I/E) [" + string(1, t.type) + "]:", 200, 300, 400, 30);
-            if (!new_type_str.empty() && (toupper(new_type_str[0]) == 'I' || toupper(new_type_str[0]) == 'E')) {
-                t.type = toupper(new_type_str[0]);
-            } else if (!new_type_str.empty()) {
-                 clear_screen(COLOR_WHITE);
-                 draw_text_centered("Invalid type. Not updated.", screen_height() / 2);
-                 wait_for_mouse_click_to_return();
-            }
+/**
+ * Commit and close the open journal so its file can be renamed or removed
+ */
+void closeJournal() {
+    commitJournal();
+    g_journal.close();
+}
 
-            clear_screen(COLOR_WHITE);
-            draw_text_centered("Transaction updated!", screen_height() / 2);
-            wait_for_mouse_click_to_return();
+/**
+ * Append text to a user's journal, keeping the file open between writes. The text is not
+ * durable until commitJournal; switching to another journal commits the previous one.
+ * Runs on the persistence thread.
+ */
+void writeJournal(const string& path, const string& text) {
+    if (!g_journal.is_open() || g_journal.path() != path) {
+        closeJournal();
+        if (!g_journal.open(path)) {
+            write_line("ERROR: Could not open " + path + " for appending.");
             return;
         }
-        else if (is_button_clicked(start_x + btn_width + btn_spacing, 250, btn_width, btn_height)) { // Delete button
-            user.transactions.erase(it);
-            clear_screen(COLOR_WHITE);
-            draw_text_centered("Transaction deleted!", screen_height() / 2);
-            wait_for_mouse_click_to_return();
+    }
+    if (!g_journal.append(text)) write_line("ERROR: Could not append to " + path);
+}
+
+
+/**
+ * Write a user's snapshot next to its final path and rename it into place,
+ * so readers only ever see a complete snapshot. Returns false on failure.
+ */
+bool replaceUserSnapshot(const UserProfile& user) {
+    const string path = userSnapshotPath(user.username);
+    const string tmp_path = path + ".tmp";
+    if (!writeUserSnapshotFile(user, tmp_path, g_snapshot_format)) return false;
+    return renameDurably(tmp_path, path);
+}
+
+/**
+ * Fold a user's journal into a new snapshot. The live journal is set aside first, then the
+ * snapshot is written and renamed into place, and only then is the set-aside journal
+ * removed, so a crash at any point leaves a snapshot plus journals that replay correctly.
+ * Runs on the persistence thread.
+ */
+void writeShardSnapshot(const UserProfile& snapshot) {
+    closeJournal();
+    const string journal_path = userJournalPath(snapshot.username);
+    const string compacting_path = userCompactingJournalPath(snapshot.username);
+    error_code ec;
+    if (filesystem::exists(compacting_path, ec)) {
+        // Left over from an interrupted compaction; keep its records until a snapshot covers them
+        ofstream pending(compacting_path, ios::app);
+        ifstream live(journal_path);
+        if (live.peek() != ifstream::traits_type::eof()) pending << live.rdbuf();
+        pending.close();
+        if (pending.fail() || !syncPath(compacting_path)) {
+            write_line("ERROR: Could not set aside the journal of " + snapshot.username);
             return;
         }
-        else if (is_button_clicked(start_x + 2 * (btn_width + btn_spacing), 250, btn_width, btn_height)) { // Cancel button
+        live.close();
+        filesystem::remove(journal_path, ec);
+    } else if (filesystem::exists(journal_path, ec)) {
+        if (!renameDurably(journal_path, compacting_path)) {
+            write_line("ERROR: Could not set aside the journal of " + snapshot.username);
             return;
         }
-        delay(10);
+    }
+
+    if (replaceUserSnapshot(snapshot)) {
+        filesystem::remove(compacting_path, ec);
+    } else {
+        write_line("ERROR: Could not write the snapshot for " + snapshot.username + "; keeping the journal.");
     }
 }
 
+// --- Background Persistence ---
+//
+// All disk writes made while the app runs happen on one persistence thread. The UI thread
+// only queues tasks: journal records (deltas) and immutable copies of users to snapshot.
+// Tasks run in queue order, which keeps a snapshot consistent with the journal it folds.
+
+const size_t PERSISTENCE_QUEUE_CAPACITY = 4096; // Queued tasks before the UI waits for the disk
+
+struct PersistenceTask {
+    enum class Kind { AppendJournal, AppendIndex, WriteSnapshot };
+    Kind kind;
+    string path;                            // File the record is appended to
+    string record;                          // Line to append, without its newline
+    shared_ptr<const UserProfile> snapshot; // User to write a snapshot of
+    chrono::steady_clock::time_point queued_at{};
+};
+
+mutex g_persistence_mutex;
+condition_variable g_persistence_wakeup;   // Signals the worker that tasks arrived
+condition_variable g_persistence_progress; // Signals producers that tasks were taken or finished
+deque<PersistenceTask> g_persistence_queue;
+size_t g_persistence_in_flight = 0;        // Tasks taken by the worker but not yet finished
+bool g_persistence_stopping = false;
+thread g_persistence_thread;
 
 /**
- * Calculate and display summary: total income, total expense, net amount
+ * Run one batch of tasks taken from the queue. Consecutive records for the same journal
+ * are coalesced into a single write, and each journal touched is synced once (group
+ * commit). Returns latency figures for the records made durable.
  */
-void draw_summary(const vector<Transaction>& transactions) {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Financial Summary ---", 20);
+DurabilityStats runPersistenceBatch(vector<PersistenceTask>& batch) {
+    DurabilityStats stats;
+    vector<chrono::steady_clock::time_point> uncommitted; // Queue times of records not yet synced
+    auto commit = [&] {
+        if (uncommitted.empty()) return;
+        commitJournal();
+        auto now = chrono::steady_clock::now();
+        for (auto queued_at : uncommitted) {
+            double ms = chrono::duration<double, milli>(now - queued_at).count();
+            stats.total_latency_ms += ms;
+            stats.max_latency_ms = max(stats.max_latency_ms, ms);
+        }
+        stats.records += uncommitted.size();
+        stats.commits++;
+        stats.last_committed = now;
+        uncommitted.clear();
+    };
 
-    float totalIncome = 0, totalExpense = 0;
-    for (const auto& t : transactions) {
-        if (t.type == 'I') totalIncome += t.amount;
-        else if (t.type == 'E') totalExpense += t.amount;
+    for (size_t i = 0; i < batch.size(); i++) {
+        PersistenceTask& task = batch[i];
+        if (task.kind == PersistenceTask::Kind::AppendJournal) {
+            if (g_journal.path() != task.path) commit();
+            string text = task.record + "\n";
+            uncommitted.push_back(task.queued_at);
+            while (i + 1 < batch.size() && batch[i + 1].kind == PersistenceTask::Kind::AppendJournal &&
+                   batch[i + 1].path == task.path) {
+                text += batch[++i].record + "\n";
+                uncommitted.push_back(batch[i].queued_at);
+            }
+            writeJournal(task.path, text);
+        } else if (task.kind == PersistenceTask::Kind::AppendIndex) {
+            AppendFile index;
+            if (!index.open(task.path) || !index.append(task.record + "\n") || !index.sync()) {
+                write_line("ERROR: Could not append to " + task.path);
+            }
+        } else {
+            commit();
+            writeShardSnapshot(*task.snapshot);
+        }
     }
-
-    draw_text("Total Income: $" + format_amount(totalIncome), COLOR_GREEN, 50, 80);
-    draw_text("Total Expense: $" + format_amount(totalExpense), COLOR_RED, 50, 120);
-    draw_text("Net: $" + format_amount(totalIncome - totalExpense), COLOR_BLUE, 50, 160);
-
-    wait_for_mouse_click_to_return();
+    commit();
+    return stats;
 }
 
 /**
- * Display budget report comparing budgeted amount vs spent amount per category.
- * Shows categories in red if spending exceeds budget and gives warnings.
+ * Body of the persistence thread: take everything queued, run it, repeat.
+ * Exits once asked to stop and the queue is empty.
  */
-void drawBudgetReport(const UserProfile& user) {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Budget Report for " + user.username + " ---", 20);
+void persistenceWorker() {
+    unique_lock<mutex> lock(g_persistence_mutex);
+    while (true) {
+        g_persistence_wakeup.wait(lock, [] { return !g_persistence_queue.empty() || g_persistence_stopping; });
+        if (g_persistence_queue.empty()) break; // Stopping with nothing left to do
 
-    auto expenses = calculateExpensesByCategory(user.transactions);
+        // Group commit: let records arriving within the window share this batch's fsync
+        g_persistence_wakeup.wait_for(lock, g_group_commit_settings.window, [] {
+            return g_persistence_stopping || g_persistence_queue.size() >= PERSISTENCE_QUEUE_CAPACITY;
+        });
 
-    int y = 80;
-    bool budget_exceeded_any_category = false;
-    for (const auto& [cat, budget] : user.budgetPerCategory) {
-        float spent = expenses[cat];
-        string line = cat + ": Budget = $" + format_amount(budget) + ", Spent = $" + format_amount(spent);
-        color display_color = COLOR_BLACK;
-        if (spent > budget) {
-            display_color = COLOR_RED;
-            budget_exceeded_any_category = true;
-        } else if (budget > 0 && spent / budget >= 0.9) { // Warn if close to budget (90% or more)
-             display_color = COLOR_ORANGE;
+        vector<PersistenceTask> batch(make_move_iterator(g_persistence_queue.begin()),
+                                      make_move_iterator(g_persistence_queue.end()));
+        g_persistence_queue.clear();
+        g_persistence_in_flight = batch.size();
+        auto first_queued = batch.front().queued_at;
+        g_persistence_progress.notify_all();
+
+        lock.unlock();
+        DurabilityStats batch_stats = runPersistenceBatch(batch);
+        lock.lock();
+
+        if (batch_stats.records > 0) {
+            DurabilityStats& total = g_durability_stats;
+            if (total.records == 0) total.first_queued = first_queued;
+            total.records += batch_stats.records;
+            total.commits += batch_stats.commits;
+            total.total_latency_ms += batch_stats.total_latency_ms;
+            total.max_latency_ms = max(total.max_latency_ms, batch_stats.max_latency_ms);
+            total.last_committed = batch_stats.last_committed;
         }
-        draw_text(line, display_color, 50, y);
-        y += 30;
+        g_persistence_in_flight = 0;
+        g_persistence_progress.notify_all();
     }
+    closeJournal();
+}
 
-    if (budget_exceeded_any_category) {
-        draw_text_centered("WARNING: You have exceeded budget in one or more categories!", screen_height() - 80, COLOR_RED);
-    } else if (user.budgetPerCategory.empty()){
-        draw_text_centered("No budget categories set. Go to 'Set Budget' to add some!", screen_height() / 2, COLOR_GRAY);
+/**
+ * Queue a task for the persistence thread, starting it on first use.
+ * A newer snapshot of a user replaces one still waiting in the queue. The UI only waits
+ * here if the disk has fallen PERSISTENCE_QUEUE_CAPACITY tasks behind.
+ */
+void enqueuePersistenceTask(PersistenceTask task) {
+    unique_lock<mutex> lock(g_persistence_mutex);
+    if (!g_persistence_thread.joinable()) {
+        g_persistence_stopping = false;
+        g_persistence_thread = thread(persistenceWorker);
     }
 
+    if (task.kind == PersistenceTask::Kind::WriteSnapshot) {
+        const string& username = task.snapshot->username;
+        auto superseded = find_if(g_persistence_queue.begin(), g_persistence_queue.end(), [&](const PersistenceTask& queued) {
+            return queued.kind == PersistenceTask::Kind::WriteSnapshot && queued.snapshot->username == username;
+        });
+        if (superseded != g_persistence_queue.end()) g_persistence_queue.erase(superseded);
+    }
 
-    wait_for_mouse_click_to_return();
+    g_persistence_progress.wait(lock, [] { return g_persistence_queue.size() < PERSISTENCE_QUEUE_CAPACITY; });
+    task.queued_at = chrono::steady_clock::now();
+    g_persistence_queue.push_back(move(task));
+    g_persistence_wakeup.notify_one();
 }
 
 /**
- * UI to set/edit budget per category
+ * Wait until every queued task has been written
  */
-void set_budget_ui(UserProfile& user) {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Set Budget Per Category ---", 50);
+void waitForPersistence() {
+    unique_lock<mutex> lock(g_persistence_mutex);
+    g_persistence_progress.wait(lock, [] { return g_persistence_queue.empty() && g_persistence_in_flight == 0; });
+}
 
-    // Display current budgets
-    int y_current_budgets = 100;
-    draw_text("Current Budgets:", COLOR_BLACK, 50, y_current_budgets);
-    y_current_budgets += 20;
-    if (user.budgetPerCategory.empty()) {
-        draw_text("No budgets set yet.", COLOR_GRAY, 70, y_current_budgets);
-        y_current_budgets += 20;
-    } else {
-        for (const auto& [cat, budget] : user.budgetPerCategory) {
-            draw_text(cat + ": $" + format_amount(budget), COLOR_BLACK, 70, y_current_budgets);
-            y_current_budgets += 20;
-        }
-    }
+/**
+ * Queue one record for a user's journal
+ */
+void appendJournalRecord(UserProfile& user, const string& record) {
+    enqueuePersistenceTask({PersistenceTask::Kind::AppendJournal, userJournalPath(user.username), record, nullptr});
+    user.journal_records++;
+    user.journal_bytes += record.size() + 1;
+}
 
+/**
+ * Record a new user in the index. The index is only ever appended to,
+ * so registration costs O(1) regardless of how many users exist.
+ */
+void journalRegisterUser(const UserProfile& user) {
+    enqueuePersistenceTask({PersistenceTask::Kind::AppendIndex, USER_INDEX_FILE, "USER|" + user.username + "|" + user.password, nullptr});
+}
 
-    string category = get_text_input("Enter Category to set budget for (e.g., Food, Transport):", 200, y_current_budgets + 50, 400, 30);
-    if (category.empty()) return;
+void journalAddTransaction(UserProfile& user, const Transaction& t) {
+    appendJournalRecord(user, "ADD|" + user.username + "|" + formatTransactionFields(user, t));
+}
 
-    string amount_str = get_text_input("Enter Budget Amount for " + category + ":", 200, y_current_budgets + 100, 400, 30);
-    if (amount_str.empty()) return;
+void journalEditTransaction(UserProfile& user, const Transaction& t) {
+    appendJournalRecord(user, "EDIT|" + user.username + "|" + formatTransactionFields(user, t));
+}
 
-    float amount;
-    try {
-        amount = stof(amount_str);
-    } catch (...) {
-        clear_screen(COLOR_WHITE);
-        draw_text_centered("Invalid amount. Please enter a valid number.", screen_height() / 2);
-        wait_for_mouse_click_to_return();
-        return;
-    }
+void journalDeleteTransaction(UserProfile& user, int id) {
+    appendJournalRecord(user, "DELETE|" + user.username + "|" + to_string(id));
+}
 
-    user.budgetPerCategory[category] = amount;
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("Budget for " + category + " set to $" + format_amount(amount) + "!", screen_height() / 2);
-    wait_for_mouse_click_to_return();
+void journalSetBudget(UserProfile& user, const string& category, Money amount) {
+    ostringstream oss;
+    oss << "BUDGET|" << user.username << "|" << category << "|" << format_amount(amount);
+    appendJournalRecord(user, oss.str());
 }
 
 /**
- * Display time-series report (monthly/yearly summary)
+ * Queue a snapshot of the user as they are now. The copy is immutable, so the UI can keep
+ * changing the user while the persistence thread writes it.
  */
-void draw_time_series_report(const UserProfile& user) {
-    clear_screen(COLOR_WHITE);
-    draw_text_centered("--- Time Series Report ---", 20);
-
-    map<string, float> monthly_income;
-    map<string, float> monthly_expense;
-    map<string, float> yearly_income;
-    map<string, float> yearly_expense;
-
-    for (const auto& t : user.transactions) {
-        int year, month, day;
-        if (parse_date(t.date, year, month, day)) {
-            // Format month_key as YYYY-MM to ensure correct sorting
-            string month_key = to_string(year) + "-" + (month < 10 ? "0" : "") + to_string(month);
-            string year_key = to_string(year);
-
-            if (t.type == 'I') {
-                monthly_income[month_key] += t.amount;
-                yearly_income[year_key] += t.amount;
-            } else {
-                monthly_expense[month_key] += t.amount;
-                yearly_expense[year_key] += t.amount;
-            }
-        }
-    }
+void queueUserSnapshot(UserProfile& user) {
+    user.transactions.compact(); // Snapshot time is a natural point to drop deleted rows
+    enqueuePersistenceTask({PersistenceTask::Kind::WriteSnapshot, "", "", make_shared<const UserProfile>(user)});
+    user.journal_records = 0;
+    user.journal_bytes = 0;
+    user.dirty = false; // The queued copy covers every change so far
+}
 
-    int y = 60;
-    draw_text("Monthly Summary:", COLOR_BLACK, 50, y);
-    y += 25;
-    // Sort monthly data by key
-    vector<pair<string, float>> sorted_monthly_income(monthly_income.begin(), monthly_income.end());
-    sort(sorted_monthly_income.begin(), sorted_monthly_income.end());
-
-    for (const auto& pair : sorted_monthly_income) {
-        string month_year = pair.first;
-        float income = pair.second;
-        float expense = monthly_expense[month_year]; // Get corresponding expense
-        draw_text(month_year + ": Income=$" + format_amount(income) + ", Expense=$" + format_amount(expense) + ", Net=$" + format_amount(income - expense), COLOR_BLACK, 70, y);
-        y += 20;
-    }
+/**
+ * Read a user's shard: their snapshot, then any journal left by an interrupted
+ * compaction, then the live journal. Called on login.
+ */
+void loadUserData(UserProfile& user) {
+    if (user.data_loaded) return;
+    waitForPersistence(); // Records queued before a logout must be on disk before reading them back
 
-    y += 30; // Spacer
-    draw_text("Yearly Summary:", COLOR_BLACK, 50, y);
-    y += 25;
-    // Sort yearly data by key
-    vector<pair<string, float>> sorted_yearly_income(yearly_income.begin(), yearly_income.end());
-    sort(sorted_yearly_income.begin(), sorted_yearly_income.end());
-
-    for (const auto& pair : sorted_yearly_income) {
-        string year = pair.first;
-        float income = pair.second;
-        float expense = yearly_expense[year]; // Get corresponding expense
-        draw_text(year + ": Income=$" + format_amount(income) + ", Expense=$" + format_amount(expense) + ", Net=$" + format_amount(income - expense), COLOR_BLACK, 70, y);
-        y += 20;
+    vector<UserProfile> shard;
+    if (loadSnapshotFile(userSnapshotPath(user.username), shard) && !shard.empty()) {
+        user.transactions = move(shard[0].transactions);
+        user.budgetPerCategory = move(shard[0].budgetPerCategory);
+        user.categories = move(shard[0].categories);
+        user.next_transaction_id = shard[0].next_transaction_id;
     }
+    size_t pending_records = replayUserJournal(user, userCompactingJournalPath(user.username));
+    user.journal_records = replayUserJournal(user, userJournalPath(user.username));
+    error_code ec;
+    auto journal_size = filesystem::file_size(userJournalPath(user.username), ec);
+    user.journal_bytes = ec ? 0 : static_cast<size_t>(journal_size);
+    user.data_loaded = true;
+    user.dirty = pending_records + user.journal_records > 0; // Snapshot is behind the journal
+}
 
-    wait_for_mouse_click_to_return();
+/**
+ * Drop a user's transactions and budgets from memory on logout.
+ * Every mutation is already in their journal, so nothing is lost.
+ */
+void unloadUserData(UserProfile& user) {
+    user.transactions = TransactionStore();
+    user.budgetPerCategory.clear();
+    user.categories = CategoryDictionary();
+    user.data_loaded = false;
 }
 
+/**
+ * Queue a compaction of a user's shard once their journal passes either threshold.
+ * Must be called between mutations so the copied user is consistent with the records
+ * queued so far. Never blocks on disk writes.
+ */
+void maybeStartCompaction(UserProfile& user) {
+    if (!user.data_loaded) return;
+    if (user.journal_records < g_compaction_settings.max_journal_records &&
+        user.journal_bytes < g_compaction_settings.max_journal_bytes) return;
+    queueUserSnapshot(user);
+}
 
-// --- File Management ---
+/**
+ * Queue snapshots of users changed since their snapshot was written, folding their journals
+ * into them. Clean users are skipped, so the cost is proportional to what was modified.
+ */
+void saveToFile(UserRegistry& users) {
+    for (auto& user : users) {
+        if (user.data_loaded && user.dirty) queueUserSnapshot(user);
+    }
+}
 
 /**
- * Save all user profiles with transactions and budgets to file "users.txt"
+ * Snapshot changed users, wait for every queued write to reach disk and stop the
+ * persistence thread. Called once on exit.
  */
-void saveToFile(const vector<UserProfile>& users) {
-    ofstream ofs("users.txt");
-    if (!ofs.is_open()) {
-        write_line("ERROR: Could not open users.txt for saving.");
-        return;
+void flushPersistence(UserRegistry& users) {
+    saveToFile(users);
+    {
+        lock_guard<mutex> lock(g_persistence_mutex);
+        g_persistence_stopping = true;
     }
-    for (const auto& user : users) {
-        ofs << "USER|" << user.username << "|" << user.password << "\n"; // Save username and password
-        ofs << "NEXT_ID|" << user.next_transaction_id << "\n"; // Save next transaction ID for continuity
+    g_persistence_wakeup.notify_one();
+    if (g_persistence_thread.joinable()) g_persistence_thread.join();
+    if (g_durability_stats.records > 0) write_line("Durability: " + formatDurabilityStats(g_durability_stats));
+}
 
-        ofs << "BUDGETS|";
-        for (const auto& [cat, val] : user.budgetPerCategory) {
-            ofs << cat << ":" << val << ",";
-        }
-        ofs << "\n";
+/**
+ * Convert the single-file layout (users.txt plus its journals) into the user index and
+ * per-user shards. The index is written last and renamed into place, so an interrupted
+ * migration simply runs again; the old files are kept with a ".migrated" suffix.
+ */
+bool migrateSingleFileStorage() {
+    vector<UserProfile> snapshot;
+    loadSnapshotFile(USERS_FILE, snapshot);
+    UserRegistry users;
+    for (auto& user : snapshot) users.add(move(user));
+    replayJournal(users, COMPACTING_JOURNAL_FILE);
+    replayJournal(users, JOURNAL_FILE);
 
-        for (const auto& t : user.transactions) {
-            ofs << "TRANS|" << t.id << "|" << t.date << "|" << t.category << "|" << t.description << "|" << t.amount << "|" << t.type << "\n";
+    for (const auto& user : users) {
+        if (!replaceUserSnapshot(user)) {
+            write_line("ERROR: Could not migrate " + user.username + " to " + USER_DATA_DIR);
+            return false;
         }
-        ofs << "ENDUSER\n";
+    }
+
+    const string tmp_path = USER_INDEX_FILE + ".tmp";
+    ofstream ofs(tmp_path, ios::trunc);
+    for (const auto& user : users) {
+        ofs << "USER|" << user.username << "|" << user.password << "\n";
     }
     ofs.close();
+    if (ofs.fail() || !renameDurably(tmp_path, USER_INDEX_FILE)) return false;
+
+    error_code ec;
+    for (const string& old_file : {USERS_FILE, JOURNAL_FILE, COMPACTING_JOURNAL_FILE}) {
+        if (filesystem::exists(old_file, ec)) filesystem::rename(old_file, old_file + ".migrated", ec);
+    }
+    return true;
 }
 
 /**
- * Load all user profiles from file "users.txt" including their transactions and budgets
+ * Load every user's name and password from the index. Transactions and budgets stay on
+ * disk until the user logs in (see loadUserData), so startup does not grow with history.
  */
-void loadFromFile(vector<UserProfile>& users) {
-    ifstream ifs("users.txt");
-    if (!ifs.is_open()) return;
-
+void loadFromFile(UserRegistry& users) {
     users.clear();
 
+    error_code ec;
+    filesystem::create_directories(USER_DATA_DIR, ec);
+    if (!filesystem::exists(USER_INDEX_FILE, ec) &&
+        (filesystem::exists(USERS_FILE, ec) || filesystem::exists(JOURNAL_FILE, ec))) {
+        if (!migrateSingleFileStorage()) write_line("ERROR: Could not migrate " + USERS_FILE + " to per-user storage.");
+    }
+
+    ifstream ifs(USER_INDEX_FILE);
     string line;
-    UserProfile* currentUser = nullptr;
-    while (getline(ifs, line)) {
-        if (line.rfind("USER|", 0) == 0) {
-            users.push_back(UserProfile());
-            currentUser = &users.back();
-            stringstream ss(line);
-            string token;
-            getline(ss, token, '|'); // Read "USER" token
-            getline(ss, currentUser->username, '|'); // Read username
-            getline(ss, currentUser->password, '|'); // Read password
-        } else if (line.rfind("NEXT_ID|", 0) == 0 && currentUser != nullptr) {
-            currentUser->next_transaction_id = stoi(line.substr(8));
-        }
-        else if (line.rfind("BUDGETS|", 0) == 0 && currentUser != nullptr) {
-            string budgets_str = line.substr(8);
-            stringstream ss(budgets_str);
-            string part;
-            while (getline(ss, part, ',')) {
-                if (part.empty()) continue;
-                auto pos = part.find(':');
-                if (pos != string::npos) {
-                    string cat = part.substr(0, pos);
-                    float val = stof(part.substr(pos + 1));
-                    currentUser->budgetPerCategory[cat] = val;
-                }
-            }
-        } else if (line.rfind("TRANS|", 0) == 0 && currentUser != nullptr) {
-            stringstream ss(line);
-            string token;
-            vector<string> parts;
-            // Use a loop to split by '|'
-            while (getline(ss, token, '|')) {
-                parts.push_back(token);
-            }
-            if (parts.size() == 7) { // Expect 7 parts: "TRANS", id, date, category, desc, amount, type
-                int id = stoi(parts[1]);
-                string date = parts[2];
-                string cat = parts[3];
-                string desc = parts[4];
-                float amount = stof(parts[5]);
-                char type = parts[6][0];
-                currentUser->transactions.push_back({date, cat, desc, amount, type, id});
-            }
-        } else if (line == "ENDUSER") {
-            currentUser = nullptr;
-        }
+    while (ifs.is_open() && getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!startsWith(line, "USER|")) continue;
+        string_view fields = string_view(line).substr(5);
+        UserProfile user;
+        user.username = nextField(fields, '|');
+        user.password = nextField(fields, '|');
+        users.add(move(user)); // First entry wins if the index repeats a name
     }
-    ifs.close();
 }
 
 // --- Authentication and User Management ---
@@ -650,12 +4305,11 @@ bool handle_user_authentication() {
             password_input = get_text_input("Enter Password:", 200, 350, 400, 30);
             if (password_input.empty()) return false; // User cancelled
 
-            auto it = find_if(g_users.begin(), g_users.end(), [&](const UserProfile& u) {
-                return u.username == username_input;
-            });
+            UserProfile* user = g_users.find(username_input);
 
-            if (it != g_users.end() && it->password == password_input) {
-                g_current_user = &(*it);
+            if (user && user->password == password_input) {
+                g_current_user = user;
+                loadUserData(*g_current_user); // Only this user's transactions are read
                 clear_screen(COLOR_WHITE); // Clear before success message
                 draw_text_centered("Login successful!", screen_height() / 2);
                 wait_for_mouse_click_to_return();
@@ -673,17 +4327,19 @@ bool handle_user_authentication() {
             password_input = get_text_input("Choose Password:", 200, 350, 400, 30);
             if (password_input.empty()) return false;
 
-            // Check if username already exists
-            if (find_if(g_users.begin(), g_users.end(), [&](const UserProfile& u) { return u.username == username_input; }) != g_users.end()) {
+            // Fails if the username already exists
+            UserProfile* user = g_users.add(UserProfile{username_input, password_input});
+            if (!user) {
                 clear_screen(COLOR_WHITE); // Clear before error message
                 draw_text_centered("Username already taken. Please choose another.", screen_height() / 2);
                 wait_for_mouse_click_to_return();
                 return false;
             }
 
-            g_users.push_back(UserProfile{username_input, password_input});
-            g_current_user = &g_users.back();
-            saveToFile(g_users); // Save new user
+            g_current_user = user;
+            g_current_user->data_loaded = true; // Nothing on disk yet
+            g_current_user->dirty = true;       // Give the new user a snapshot on exit
+            journalRegisterUser(*g_current_user); // Persist new user
             clear_screen(COLOR_WHITE); // Clear before success message
             draw_text_centered("Registration successful! Logged in as " + username_input, screen_height() / 2);
             wait_for_mouse_click_to_return();
@@ -698,8 +4354,256 @@ bool handle_user_authentication() {
 }
 
 
+// --- Command Line Tools ---
+
+/**
+ * Convert a snapshot to the given format. The input format is detected automatically.
+ */
+int convert_snapshot_tool(const string& in_path, const string& out_path, SnapshotFormat format) {
+    vector<UserProfile> users;
+    if (!loadSnapshotFile(in_path, users)) {
+        write_line("ERROR: Could not read snapshot " + in_path);
+        return 1;
+    }
+    if (!writeSnapshotFile(users, out_path, format)) {
+        write_line("ERROR: Could not write " + out_path);
+        return 1;
+    }
+    write_line("Converted " + to_string(users.size()) + " users from " + in_path + " to " + out_path);
+    return 0;
+}
+
+/**
+ * Compare two sets of user profiles field by field
+ */
+bool same_user_profiles(const vector<UserProfile>& a, const vector<UserProfile>& b) {
+    return equal(a.begin(), a.end(), b.begin(), b.end(), [&](const UserProfile& x, const UserProfile& y) {
+        // Category ids are per dictionary, so compare names
+        auto same_transaction = [&](TransactionRef s, TransactionRef t) {
+            return s.id() == t.id() && s.date() == t.date() && x.categories.name(s.category()) == y.categories.name(t.category()) &&
+                   s.description() == t.description() && s.amount() == t.amount() && s.type() == t.type();
+        };
+        return x.username == y.username && x.password == y.password &&
+               x.next_transaction_id == y.next_transaction_id && x.budgetPerCategory == y.budgetPerCategory &&
+               equal(x.transactions.begin(), x.transactions.end(), y.transactions.begin(), y.transactions.end(), same_transaction);
+    });
+}
+
+/**
+ * Time one snapshot loader, best of three runs, in milliseconds
+ */
+double time_loader(bool (*loader)(const string&, vector<UserProfile>&), const string& path, vector<UserProfile>& users) {
+    double best = 0;
+    for (int run = 0; run < 3; run++) {
+        users.clear();
+        auto start = chrono::steady_clock::now();
+        loader(path, users);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (run == 0 || ms < best) best = ms;
+    }
+    return best;
+}
+
+/**
+ * Generate a synthetic snapshot of roughly `lines` lines and compare snapshot loaders on it
+ */
+int bench_load_tool(size_t lines) {
+    const char* categories[] = {"Food", "Transport", "Rent", "Utilities", "Entertainment", "Salary"};
+    const size_t transactions_per_user = 100000;
+    vector<UserProfile> users;
+    for (size_t written = 0; written < lines; ) {
+        UserProfile user{"user" + to_string(users.size()), "password", {}, {}};
+        for (const char* cat : categories) user.budgetPerCategory[cat] = Money{50000};
+        for (size_t i = 0; i < transactions_per_user && written < lines; i++, written++) {
+            unsigned day = static_cast<unsigned>(i % 28) + 1, month = static_cast<unsigned>(i / 28 % 12) + 1;
+            Date date{static_cast<int32_t>(daysFromCivil(2025, month, day))};
+            user.transactions.push_back({date, user.categories.intern(categories[i % 6]), "Transaction number " + to_string(i),
+                                         Money{static_cast<int64_t>(i % 10000)}, i % 6 == 5 ? 'I' : 'E', user.next_transaction_id++});
+        }
+        users.push_back(move(user));
+    }
+
+    const string text_path = (filesystem::temp_directory_path() / "bench_users.txt").string();
+    const string binary_path = (filesystem::temp_directory_path() / "bench_users.bin").string();
+    const string compressed_path = (filesystem::temp_directory_path() / "bench_users.cmp").string();
+    if (!writeSnapshotFile(users, text_path, SnapshotFormat::Text) ||
+        !writeSnapshotFile(users, binary_path, SnapshotFormat::Binary) ||
+        !writeSnapshotFile(users, compressed_path, SnapshotFormat::Compressed)) {
+        write_line("ERROR: Could not write benchmark snapshots to " + filesystem::temp_directory_path().string());
+        return 1;
+    }
+
+    vector<UserProfile> reference, parsed, binary, compressed;
+    double streams_ms = time_loader(loadTextSnapshotWithStreams, text_path, reference);
+    double text_ms = time_loader(loadTextSnapshot, text_path, parsed);
+    double binary_ms = time_loader(loadBinarySnapshot, binary_path, binary);
+    double compressed_ms = time_loader(loadCompressedSnapshot, compressed_path, compressed);
+    bool identical = same_user_profiles(reference, parsed) && same_user_profiles(reference, binary) &&
+                     same_user_profiles(reference, compressed);
+    auto two_places = [](double value) {
+        ostringstream oss;
+        oss << fixed << setprecision(2) << value;
+        return oss.str();
+    };
+    auto megabytes = [&](const string& path) { return two_places(filesystem::file_size(path) / 1048576.0) + " MB"; };
+
+    write_line("Snapshot with " + to_string(lines) + " transactions across " + to_string(users.size()) + " users");
+    write_line("  sizes: text " + megabytes(text_path) + ", binary " + megabytes(binary_path) +
+               ", compressed " + megabytes(compressed_path));
+    write_line("  text, getline/stringstream: " + two_places(streams_ms) + " ms");
+    write_line("  text, string_view/from_chars: " + two_places(text_ms) + " ms (" +
+               two_places(streams_ms / text_ms) + "x)");
+    write_line("  binary, mmap: " + two_places(binary_ms) + " ms (" +
+               two_places(streams_ms / binary_ms) + "x)");
+    write_line("  compressed: " + two_places(compressed_ms) + " ms (" +
+               two_places(streams_ms / compressed_ms) + "x)");
+    write_line(identical ? "  all loaders produced identical users" : "  ERROR: loaders disagree");
+
+    filesystem::remove(text_path);
+    filesystem::remove(binary_path);
+    filesystem::remove(compressed_path);
+    return identical ? 0 : 1;
+}
+
+/**
+ * Push journal records through the persistence thread and report durability latency and
+ * throughput, once syncing every batch immediately and once with the group commit window.
+ * Runs in a scratch directory so no real data is touched.
+ */
+int bench_commit_tool(size_t records, int interval_us) {
+    const auto scratch = filesystem::temp_directory_path() / "bank_bench_commit";
+    const auto original_dir = filesystem::current_path();
+    filesystem::remove_all(scratch);
+    filesystem::create_directories(scratch / USER_DATA_DIR);
+    filesystem::current_path(scratch);
+
+    const auto configured_window = g_group_commit_settings.window;
+    for (auto window : {chrono::milliseconds(0), configured_window}) {
+        g_group_commit_settings.window = window;
+        {
+            lock_guard<mutex> lock(g_persistence_mutex);
+            g_durability_stats = DurabilityStats();
+        }
+        UserProfile user{"bench", "bench", {}, {}};
+        user.data_loaded = true;
+        for (size_t i = 0; i < records; i++) {
+            Transaction t{Date{static_cast<int32_t>(daysFromCivil(2025, 1, 1))}, user.categories.intern("Food"), "Benchmark record", Money{100}, 'E', user.next_transaction_id++};
+            journalAddTransaction(user, t);
+            if (interval_us > 0) this_thread::sleep_for(chrono::microseconds(interval_us));
+        }
+        waitForPersistence();
+        lock_guard<mutex> lock(g_persistence_mutex);
+        write_line("Group commit window " + to_string(window.count()) + " ms: " + formatDurabilityStats(g_durability_stats));
+    }
+    g_group_commit_settings.window = configured_window;
+
+    UserRegistry none;
+    flushPersistence(none);
+    filesystem::current_path(original_dir);
+    filesystem::remove_all(scratch);
+    return 0;
+}
+
+/**
+ * Generate amount and type columns and time every aggregation kernel level this CPU
+ * supports against the scalar one. Every level must match the scalar sums exactly, on
+ * the full columns and on short runs of odd length starting at unaligned rows.
+ */
+int bench_aggregate_tool(size_t rows) {
+    const size_t max_offset = 7;
+    vector<Money> amounts(rows + max_offset);
+    vector<char> types(rows + max_offset);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < amounts.size(); i++) {
+        state ^= state << 13; // xorshift64: fast enough to fill 100M rows
+        state ^= state >> 7;
+        state ^= state << 17;
+        amounts[i] = Money{static_cast<int64_t>(state % 2000000) - 1000000};
+        types[i] = "IEE\0"[state >> 40 & 3]; // Include untyped rows, as dead rows are
+    }
+
+    auto two_places = [](double value) {
+        ostringstream oss;
+        oss << fixed << setprecision(2) << value;
+        return oss.str();
+    };
+    auto same = [](const TypeSums& a, const TypeSums& b) { return a.income == b.income && a.expense == b.expense; };
+
+    const AggregationKernels& scalar = aggregationKernels(SimdLevel::Scalar);
+    const TypeSums expected = scalar.sum_by_type(amounts.data(), types.data(), rows);
+    write_line("Summing income and expenses over " + to_string(rows) + " rows; best of three runs");
+    bool identical = true;
+    double scalar_ms = 0;
+    const char* names[] = {"scalar", "SSE4.2", "AVX2", "AVX-512"};
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse42, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (level > detectSimdLevel()) {
+            write_line("  " + string(names[static_cast<int>(level)]) + ": not supported by this CPU");
+            continue;
+        }
+        const AggregationKernels& kernels = aggregationKernels(level);
+        double best = 0;
+        TypeSums sums;
+        for (int attempt = 0; attempt < 3; attempt++) {
+            auto start = chrono::steady_clock::now();
+            sums = kernels.sum_by_type(amounts.data(), types.data(), rows);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            if (attempt == 0 || ms < best) best = ms;
+        }
+        if (level == SimdLevel::Scalar) scalar_ms = best;
+
+        bool exact = same(sums, expected);
+        for (size_t offset = 0; offset <= max_offset; offset++) { // Every tail and misalignment the kernels handle
+            for (size_t n : {size_t(0), size_t(1), size_t(3), size_t(7), size_t(15), size_t(17), size_t(33), size_t(65), size_t(1001)}) {
+                if (n > rows) continue;
+                exact = exact && same(kernels.sum_by_type(amounts.data() + offset, types.data() + offset, n),
+                                      scalar.sum_by_type(amounts.data() + offset, types.data() + offset, n));
+            }
+        }
+        identical = identical && exact;
+        write_line("  " + string(kernels.name) + ": " + two_places(best) + " ms (" + two_places(scalar_ms / best) + "x)" +
+                   (exact ? "" : "  ERROR: differs from scalar"));
+    }
+    write_line(identical ? "  every level matched the scalar kernel exactly" : "  ERROR: kernels disagree");
+    return identical ? 0 : 1;
+}
+
+/**
+ * Run a maintenance tool instead of the GUI:
+ *   --to-binary <in> <out>   convert a snapshot to the binary format
+ *   --to-text <in> <out>     convert a snapshot to the users.txt text format
+ *   --to-compressed <in> <out>  convert a snapshot to the compressed format
+ *   --bench-load [lines]     time the snapshot loaders on generated data (default 5M lines)
+ *   --bench-commit [records] [interval_us]
+ *                            measure journal durability latency and throughput
+ *   --bench-aggregate [rows] time and cross-check the aggregation kernels (default 100M rows)
+ */
+int run_command_line_tool(int argc, char* argv[]) {
+    string command = argv[1];
+    if (command == "--to-binary" && argc == 4) return convert_snapshot_tool(argv[2], argv[3], SnapshotFormat::Binary);
+    if (command == "--to-text" && argc == 4) return convert_snapshot_tool(argv[2], argv[3], SnapshotFormat::Text);
+    if (command == "--to-compressed" && argc == 4) return convert_snapshot_tool(argv[2], argv[3], SnapshotFormat::Compressed);
+    if (command == "--bench-load" && argc <= 3) return bench_load_tool(argc == 3 ? stoul(argv[2]) : 5000000);
+    if (command == "--bench-commit" && argc <= 4) {
+        return bench_commit_tool(argc >= 3 ? stoul(argv[2]) : 2000, argc == 4 ? stoi(argv[3]) : 100);
+    }
+    if (command == "--bench-aggregate" && argc <= 3) return bench_aggregate_tool(argc == 3 ? stoul(argv[2]) : 100000000);
+
+    write_line("Usage:");
+    write_line("  " + string(argv[0]) + " --to-binary <in> <out>");
+    write_line("  " + string(argv[0]) + " --to-text <in> <out>");
+    write_line("  " + string(argv[0]) + " --to-compressed <in> <out>");
+    write_line("  " + string(argv[0]) + " --bench-load [lines]");
+    write_line("  " + string(argv[0]) + " --bench-commit [records] [interval_us]");
+    write_line("  " + string(argv[0]) + " --bench-aggregate [rows]");
+    write_line("  " + string(argv[0]) + " --check-totals   (run the app, verifying running totals after every change)");
+    return 1;
+}
+
 // --- Main Program ---
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc == 2 && string(argv[1]) == "--check-totals") g_check_totals = true;
+    else if (argc > 1) return run_command_line_tool(argc, argv);
+
     open_window("Personal Finance Tracker", 800, 600);
     load_font("default_font", "arial.ttf"); // Ensure font is loaded early
 
@@ -710,6 +4614,7 @@ int main() {
             if (!handle_user_authentication()) {
                 break; // Exit app if authentication fails or user chooses to exit
             }
+            checkRunningTotals(*g_current_user); // Totals built while loading and replaying the journal
         } else { // Logged in
             clear_screen(COLOR_WHITE);
             draw_text_centered("Welcome, " + g_current_user->username + "!", 20);
@@ -731,19 +4636,26 @@ int main() {
             draw_button("8. Logout", btn_x, btn_y_start + 7 * btn_spacing, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
             draw_button("9. Exit App", btn_x, btn_y_start + 8 * btn_spacing, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
 
+            // Second column: views over the user's indexes
+            float btn_x2 = btn_x + btn_width + 50;
+            draw_button("10. Transactions by Date", btn_x2, btn_y_start, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+            draw_button("11. Balance History", btn_x2, btn_y_start + btn_spacing, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+            draw_button("12. Search Transactions", btn_x2, btn_y_start + 2 * btn_spacing, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+            draw_button("13. Filter Transactions", btn_x2, btn_y_start + 3 * btn_spacing, btn_width, btn_height, COLOR_LIGHT_GRAY, COLOR_BLACK);
+
             refresh_screen();
             process_events();
 
             if (is_button_clicked(btn_x, btn_y_start, btn_width, btn_height)) { // Add Transaction
                 add_transaction_ui(*g_current_user);
-                saveToFile(g_users);
+                checkRunningTotals(*g_current_user);
             }
             else if (is_button_clicked(btn_x, btn_y_start + btn_spacing, btn_width, btn_height)) { // View All
-                draw_transactions(g_current_user->transactions);
+                draw_transactions(*g_current_user);
             }
             else if (is_button_clicked(btn_x, btn_y_start + 2 * btn_spacing, btn_width, btn_height)) { // Edit/Delete
                 edit_delete_transaction_ui(*g_current_user);
-                saveToFile(g_users);
+                checkRunningTotals(*g_current_user);
             }
             else if (is_button_clicked(btn_x, btn_y_start + 3 * btn_spacing, btn_width, btn_height)) { // Show Summary
                 draw_summary(g_current_user->transactions);
@@ -753,22 +4665,37 @@ int main() {
             }
             else if (is_button_clicked(btn_x, btn_y_start + 5 * btn_spacing, btn_width, btn_height)) { // Set Budget
                 set_budget_ui(*g_current_user);
-                saveToFile(g_users);
             }
             else if (is_button_clicked(btn_x, btn_y_start + 6 * btn_spacing, btn_width, btn_height)) { // Time Series Report
                 draw_time_series_report(*g_current_user);
             }
             else if (is_button_clicked(btn_x, btn_y_start + 7 * btn_spacing, btn_width, btn_height)) { // Logout
+                unloadUserData(*g_current_user); // Everything is journaled, so free the memory
                 g_current_user = nullptr; // Set current user to null to go back to login screen
             }
             else if (is_button_clicked(btn_x, btn_y_start + 8 * btn_spacing, btn_width, btn_height)) { // Exit App
                 break;
             }
+            else if (is_button_clicked(btn_x2, btn_y_start, btn_width, btn_height)) { // Transactions by Date
+                view_transactions_by_date_ui(*g_current_user);
+            }
+            else if (is_button_clicked(btn_x2, btn_y_start + btn_spacing, btn_width, btn_height)) { // Balance History
+                balance_history_ui(*g_current_user);
+            }
+            else if (is_button_clicked(btn_x2, btn_y_start + 2 * btn_spacing, btn_width, btn_height)) { // Search
+                search_transactions_ui(*g_current_user);
+            }
+            else if (is_button_clicked(btn_x2, btn_y_start + 3 * btn_spacing, btn_width, btn_height)) { // Filter
+                filter_transactions_ui(*g_current_user);
+            }
+        }
+        if (g_current_user != nullptr) {
+            maybeStartCompaction(*g_current_user); // Fold a long journal into the user's snapshot without blocking the UI
         }
         delay(10); // Reduce CPU usage
     }
 
-    saveToFile(g_users); // Save all data before exiting
+    flushPersistence(g_users); // Snapshot changed users and wait for all pending writes before exiting
     close_window("Personal Finance Tracker");
     return 0;
 }